@@ -1,6 +1,8 @@
 #ifndef ACGROUP_HPP
 #define ACGROUP_HPP
 
+#include "Payoff.hpp"
+#include "RandEng.hpp"
 #include <vector>
 #include <random>
 
@@ -24,13 +26,15 @@
 // 1. It is assignable
 // 2. It has the following public members of type double:
 //    q, p, w, R, theta, a, payoff, delta, elig, ztheta
+// The template parameter PayoffType is the payoff model (see Payoff.hpp).
 
-template<typename PhenType>
+template<typename PhenType, typename PayoffType = QuadPayoff>
 class ActCritGroup {
 public:
     using phen_type = PhenType;
+    using payoff_type = PayoffType;
     using v_type = std::vector<phen_type>;
-    using rand_eng = std::mt19937;
+    using rand_eng = RandEng;
     using rand_uni = std::uniform_real_distribution<double>;
     using rand_int = std::uniform_int_distribution<int>;
     using rand_norm = std::normal_distribution<double>;
@@ -47,19 +51,24 @@ public:
                  double a_alphatheta,
                  double a_lambdatheta,
                  const v_type& a_memb);
+    ActCritGroup(int a_g,
+                 int a_T,
+                 const payoff_type& a_pay,
+                 double a_sigma,
+                 double a_alphaw,
+                 double a_alphatheta,
+                 double a_lambdatheta,
+                 const v_type& a_memb);
     const v_type& Get_memb() const { return memb; }
     void Interact(rand_eng& eng);
+    // assign rewards and payoffs for the current actions (public so that it
+    // can be benchmarked)
+    void Update_R_payoff();
 
 private:
-    void Update_R_payoff();
     int g;              // group size
     int T;              // number of rounds for group interaction
-    double B0;          // payoff parameter
-    double B1;          // payoff parameter
-    double B2;          // payoff parameter
-    double K1;          // payoff parameter
-    double K11;         // payoff parameter
-    double K12;         // payoff parameter
+    payoff_type pay;    // payoff model
     double sigma;       // SD of action distribution
     double alphaw;      // learning rate
     double alphatheta;  // learning rate
@@ -67,8 +76,10 @@ private:
     v_type memb;        // members of the group
 };
 
-template<typename PhenType>
-ActCritGroup<PhenType>::ActCritGroup(int a_g,
+// constructor with the parameters of the quadratic model (other parameters
+// of the model have default values)
+template<typename PhenType, typename PayoffType>
+ActCritGroup<PhenType, PayoffType>::ActCritGroup(int a_g,
     int a_T,
     double a_B0,
     double a_B1,
@@ -81,14 +92,24 @@ ActCritGroup<PhenType>::ActCritGroup(int a_g,
     double a_alphatheta,
     double a_lambdatheta,
     const v_type& a_memb) :
+    ActCritGroup(a_g, a_T,
+                 payoff_type(PayoffPars{a_B0, a_B1, a_B2, a_K1, a_K11, a_K12}),
+                 a_sigma, a_alphaw, a_alphatheta, a_lambdatheta, a_memb)
+{
+}
+
+template<typename PhenType, typename PayoffType>
+ActCritGroup<PhenType, PayoffType>::ActCritGroup(int a_g,
+    int a_T,
+    const payoff_type& a_pay,
+    double a_sigma,
+    double a_alphaw,
+    double a_alphatheta,
+    double a_lambdatheta,
+    const v_type& a_memb) :
     g{a_g},
     T{a_T},
-    B0{a_B0},
-    B1{a_B1},
-    B2{a_B2},
-    K1{a_K1},
-    K11{a_K11},
-    K12{a_K12},
+    pay{a_pay},
     sigma{a_sigma},
     alphaw{a_alphaw},
     alphatheta{a_alphatheta},
@@ -97,8 +118,8 @@ ActCritGroup<PhenType>::ActCritGroup(int a_g,
 {
 }
 
-template<typename PhenType>
-void ActCritGroup<PhenType>::Interact(rand_eng& eng)
+template<typename PhenType, typename PayoffType>
+void ActCritGroup<PhenType, PayoffType>::Interact(rand_eng& eng)
 {
     rand_norm nrm(0.0, 1.0);
     // set payoff values to zero at start of generation
@@ -147,8 +168,8 @@ void ActCritGroup<PhenType>::Interact(rand_eng& eng)
     }
 }
 
-template<typename PhenType>
-void ActCritGroup<PhenType>::Update_R_payoff()
+template<typename PhenType, typename PayoffType>
+void ActCritGroup<PhenType, PayoffType>::Update_R_payoff()
 {
     // assign rewards and accumulate payoffs
     double av_a = 0.0;
@@ -156,10 +177,10 @@ void ActCritGroup<PhenType>::Update_R_payoff()
         av_a += m.a;
     }
     av_a /= g;
-    double B = B0 + B1*av_a + 0.5*B2*av_a*av_a;
+    double B = pay.Benefit(av_a);
     for (auto& m : memb) {
-        m.R = B - (K1 + 0.5*K11*m.a + K12*m.p)*m.a;
-        m.payoff += B - (K1 + 0.5*K11*m.a + K12*m.q)*m.a;
+        m.R = B - pay.Cost(m.a, m.p);
+        m.payoff += B - pay.Cost(m.a, m.q);
     }
 }
 
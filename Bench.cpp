@@ -0,0 +1,535 @@
+#include "EvoCode.hpp"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <sys/stat.h>
+
+// The EvoProg program runs actor-critic learning simulations
+// Copyright (C) 2019  Olof Leimar
+// See Readme.md for copyright notice
+
+// Benchmarks for parts of the EvoProg program, run with fixed seeds and
+// sizes, so that results can be compared between versions of the code on the
+// same computer. Build with make bench and run as
+//     ./Bench.exe [num_inds] [directory for files]
+// where num_inds is the number of individuals for the file benchmarks.
+// Results are written to std::cout as tab-separated text, one line per
+// benchmark, giving the number of units of work (for instance individual
+// time steps in learning, or offspring in reproduction), the time in seconds
+// and in ns per unit, and, for file benchmarks, the size of the file and the
+// throughput.
+
+namespace {
+
+using metapop_type = Evo::metapop_type;
+using ind_type = Evo::ind_type;
+using clock_type = std::chrono::steady_clock;
+
+const std::size_t NumSubPops = 10;
+
+double Seconds(clock_type::time_point t0, clock_type::time_point t1)
+{
+    return std::chrono::duration<double>(t1 - t0).count();
+}
+
+double FileMB(const std::string& filename)
+{
+    struct stat sb;
+    if (stat(filename.c_str(), &sb) != 0) return 0.0;
+    return sb.st_size/1.0e6;
+}
+
+// a population with varied (but fixed) values in all columns
+metapop_type MakePop(std::size_t num_inds)
+{
+    std::size_t max_inds = (num_inds + NumSubPops - 1)/NumSubPops;
+    metapop_type pop(NumSubPops, max_inds);
+    std::mt19937 eng(12345);
+    std::uniform_real_distribution<double> uni(-1.0, 3.0);
+    for (std::size_t n = 0; n < num_inds; ++n) {
+        std::size_t spn = n % NumSubPops;
+        ind_type indi;
+        for (std::size_t c = 0; c < ind_type::num_cols; ++c) {
+            indi.SetCol(c, uni(eng));
+        }
+        indi.phenotype.gnum = static_cast<int>(n/NumSubPops/2 + 1);
+        indi.phenotype.inum = static_cast<int>(n % 2 + 1);
+        indi.phenotype.female = true;
+        indi.spn = spn;
+        indi.alive = true;
+        pop[spn].Add(indi);
+    }
+    return pop;
+}
+
+// the writer used in earlier versions of the program
+void WriteStream(const metapop_type& pop, const std::string& outfilename)
+{
+    std::ofstream outfile(outfilename.c_str(), std::ios_base::out);
+    outfile << ind_type::ColHeads() << '\n';
+    for (std::size_t k = 0; k < pop.NumPops(); ++k) {
+        for (std::size_t i = 0; i < pop[k].Iend(); ++i) {
+            if (pop[k][i].Alive()) outfile << pop[k][i] << '\n';
+        }
+    }
+}
+
+void Report(const std::string& name, const std::string& unit,
+            std::size_t count, double secs,
+            const std::string& filename = "")
+{
+    double mb = filename.empty() ? 0.0 : FileMB(filename);
+    std::cout << name << '\t' << unit << '\t' << count << '\t' << secs
+              << '\t' << 1.0e9*secs/count << '\t'
+              << mb << '\t' << mb/secs << '\n';
+}
+
+void Report(const std::string& name, std::size_t rows, double secs,
+            const std::string& filename)
+{
+    Report(name, "row", rows, secs, filename);
+}
+
+
+//******************************* Kernels ********************************
+
+using phen_type = Evo::phen_type;
+using gam_type = Evo::gam_type;
+using acg_type = Evo::acg_type;
+using mut_rec_type = Evo::mut_rec_type;
+using subpop_type = Evo::subpop_type;
+using rand_eng = Evo::rand_eng;
+
+// parameters for the kernel benchmarks: 10 subpopulations of 500 pairs,
+// 500 rounds of learning and mutation rates that are higher than in most
+// runs, to include the cost of mutation
+const char* const BenchInp =
+    "max_num_thrds = 1\n"
+    "nsp = 10\n"
+    "ngsp = 500\n"
+    "g = 2\n"
+    "T = 500\n"
+    "numgen = 1\n"
+    "B0 = 1.0\n"
+    "B1 = 4.0\n"
+    "B2 = -2.0\n"
+    "K1 = 1.0\n"
+    "K11 = 1.0\n"
+    "K12 = -1.0\n"
+    "sigma = 0.05\n"
+    "alphaw = 0.04\n"
+    "alphatheta = 0.002\n"
+    "lambdatheta = 0.0\n"
+    "Nqv = 2\n"
+    "qv = 0.00 1.00\n"
+    "mut_rate = 0.02 0.02 0.02\n"
+    "SD = 0.04 0.04 0.04\n"
+    "max_val = 4.00 2.00 1.00\n"
+    "min_val = -1.00 -2.00 -1.00\n"
+    "rho = 0.50 0.50 0.50\n"
+    "all0 = 0.50 0.10 0.00\n"
+    "ReadFromFile = 0\n";
+
+// number of individuals in the learning benchmarks (divisible by the group
+// sizes used)
+const std::size_t NumLearnInds = 6000;
+
+// an individual with allelic values that vary around those of all0
+ind_type RandomInd(const EvoInpData& id, rand_eng& eng, std::size_t spn)
+{
+    std::normal_distribution<double> nrm(0.0, 0.1);
+    LocVec mat;
+    LocVec pat;
+    for (std::size_t l = 0; l < NumLoci; ++l) {
+        mat[l] = id.all0[l] + nrm(eng);
+        pat[l] = id.all0[l] + nrm(eng);
+    }
+    gam_type mgam(mat);
+    gam_type pgam(pat);
+    ind_type indi(std::move(mgam), std::move(pgam), spn);
+    // quality and perceived quality, as assigned in Evo::Run
+    std::bernoulli_distribution bern(0.5);
+    phen_type& ph = indi.phenotype;
+    ph.q = bern(eng) ? id.qv[1] : id.qv[0];
+    ph.p = ph.q + ph.d;
+    return indi;
+}
+
+acg_type MakeGroup(const EvoInpData& id, const std::vector<phen_type>& phen)
+{
+    return acg_type(phen.size(), id.T, id.B0, id.B1, id.B2, id.K1, id.K11,
+                    id.K12, id.sigma, id.alphaw, id.alphatheta,
+                    id.lambdatheta, phen);
+}
+
+// learning in groups of size g, over T rounds
+void BenchInteract(const EvoInpData& id, std::size_t g)
+{
+    rand_eng eng(12345);
+    std::vector<phen_type> inds;
+    for (std::size_t i = 0; i < NumLearnInds; ++i) {
+        inds.push_back(RandomInd(id, eng, 0).phenotype);
+    }
+    double sum = 0.0;
+    auto t0 = clock_type::now();
+    for (std::size_t k = 0; k < NumLearnInds/g; ++k) {
+        std::vector<phen_type> phen(inds.begin() + k*g,
+                                    inds.begin() + (k + 1)*g);
+        acg_type acg = MakeGroup(id, phen);
+        acg.Interact(eng);
+        sum += acg.Get_memb()[0].payoff;
+    }
+    auto t1 = clock_type::now();
+    Report("interact_g" + std::to_string(g), "ind_step",
+           (NumLearnInds/g)*g*id.T, Seconds(t0, t1));
+    // make sure the result is used
+    if (sum == 0.123456789) std::cerr << sum;
+}
+
+// rewards and payoffs, in a group of size 2, without learning, for the
+// payoff model PayoffType (the default model has no suffix in the name of
+// the benchmark)
+template<typename PayoffType>
+void BenchUpdatePayoff(const EvoInpData& id)
+{
+    rand_eng eng(12345);
+    std::vector<phen_type> phen;
+    for (std::size_t i = 0; i < 2; ++i) {
+        phen.push_back(RandomInd(id, eng, 0).phenotype);
+        phen.back().a = phen.back().theta;
+    }
+    PayoffPars pp{id.B0, id.B1, id.B2, id.K1, id.K11, id.K12,
+                  id.Athr, id.Bthr, 3.0};
+    ActCritGroup<phen_type, PayoffType> acg(phen.size(), id.T, PayoffType(pp),
+                                            id.sigma, id.alphaw,
+                                            id.alphatheta, id.lambdatheta,
+                                            phen);
+    const std::size_t reps = 10000000;
+    auto t0 = clock_type::now();
+    for (std::size_t r = 0; r < reps; ++r) {
+        acg.Update_R_payoff();
+    }
+    auto t1 = clock_type::now();
+    std::string name = "update_R_payoff";
+    if (std::string(PayoffType::Name) != QuadPayoff::Name) {
+        name += std::string("_") + PayoffType::Name;
+    }
+    Report(name, "ind_step", reps*phen.size(), Seconds(t0, t1));
+    if (acg.Get_memb()[0].payoff == 0.123456789) std::cerr << "\n";
+}
+
+// gametes formed with segregation, recombination and mutation
+void BenchGetGamete(const EvoInpData& id)
+{
+    rand_eng eng(12345);
+    mut_rec_type mr(eng);
+    mr.mut_rate = id.mut_rate;
+    mr.SD = id.SD;
+    mr.max_val = id.max_val;
+    mr.min_val = id.min_val;
+    mr.rho = id.rho;
+    std::vector<ind_type> inds;
+    for (std::size_t i = 0; i < 1000; ++i) {
+        inds.push_back(RandomInd(id, eng, 0));
+    }
+    const std::size_t reps = 2000000;
+    double sum = 0.0;
+    auto t0 = clock_type::now();
+    for (std::size_t r = 0; r < reps; ++r) {
+        gam_type gam = inds[r % inds.size()].genotype.GetGamete(mr);
+        sum += gam[0];
+    }
+    auto t1 = clock_type::now();
+    Report("get_gamete", "gamete", reps, Seconds(t0, t1));
+    if (sum == 0.123456789) std::cerr << sum;
+}
+
+// selection of parents, reproduction and migration, for the subpopulations
+// of evo
+void BenchReproduce(const EvoInpData& id, Evo& evo)
+{
+    rand_eng eng(12345);
+    std::uniform_real_distribution<double> uni(0.5, 1.5);
+    std::size_t Ns = id.ngsp*id.g;
+    metapop_type parents(id.nsp, Ns);
+    for (std::size_t n = 0; n < id.nsp; ++n) {
+        parents[n].st.spn = n;
+        for (std::size_t i = 0; i < Ns; ++i) {
+            ind_type indi = RandomInd(id, eng, n);
+            indi.phenotype.payoff = uni(eng);
+            parents[n].Add(indi);
+        }
+    }
+    mut_rec_type mr(eng);
+    mr.mut_rate = id.mut_rate;
+    mr.SD = id.SD;
+    mr.max_val = id.max_val;
+    mr.min_val = id.min_val;
+    mr.rho = id.rho;
+    const std::size_t reps = 5;
+    metapop_type offspr(id.nsp, Ns);
+    auto t0 = clock_type::now();
+    for (std::size_t r = 0; r < reps; ++r) {
+        for (std::size_t n = 0; n < id.nsp; ++n) {
+            offspr[n].clear();
+            offspr[n].ind = evo.SelectReproduce(parents[n], mr);
+        }
+    }
+    auto t1 = clock_type::now();
+    Report("select_reproduce", "offspring", reps*id.nsp*Ns, Seconds(t0, t1));
+
+    // the same, recording the genealogy, which is then simplified
+    std::size_t N = id.nsp*Ns;
+    std::vector<Evo::gid_vec_type> gids(id.nsp, Evo::gid_vec_type(Ns));
+    for (std::size_t n = 0; n < id.nsp; ++n) {
+        for (std::size_t i = 0; i < Ns; ++i) gids[n][i] = n*Ns + i;
+    }
+    TreeSeq ts;
+    double simp_secs = 0.0;
+    t0 = clock_type::now();
+    for (std::size_t r = 0; r < reps; ++r) {
+        ts.Start(NumLoci, N, 0, 0, 1);
+        ts.AddGeneration(1);
+        for (std::size_t n = 0; n < id.nsp; ++n) {
+            offspr[n].clear();
+            offspr[n].ind = evo.SelectReproduce(parents[n], mr, &ts, 0,
+                                                &gids[n], N + n*Ns);
+        }
+        auto ts0 = clock_type::now();
+        ts.Simplify();
+        simp_secs += Seconds(ts0, clock_type::now());
+    }
+    t1 = clock_type::now();
+    Report("select_reproduce_tree", "offspring", reps*N,
+           Seconds(t0, t1) - simp_secs);
+    Report("tree_simplify", "offspring", reps*N, simp_secs);
+
+    metapop_type next = offspr;
+    t0 = clock_type::now();
+    for (std::size_t r = 0; r < reps; ++r) {
+        evo.Migrate(offspr, next, eng);
+    }
+    t1 = clock_type::now();
+    Report("migrate_shuffle", "ind", reps*id.nsp*Ns, Seconds(t0, t1));
+}
+
+// random numbers from the engine Eng (any engine can be used here, not only
+// the one selected when compiling): raw 64-bit numbers, and uniform and
+// normal random numbers
+template<typename Eng>
+void BenchRandEng()
+{
+    Eng eng(12345);
+    const std::size_t reps = 50000000;
+    std::string name = std::string("rng_") + EngineName<Eng>();
+    std::uint64_t bits = 0;
+    auto t0 = clock_type::now();
+    for (std::size_t r = 0; r < reps; r += 2) {
+        // two 32-bit numbers from std::mt19937
+        if constexpr (Eng::max() == 0xffffffffu) {
+            bits ^= (std::uint64_t(eng()) << 32) | eng();
+        } else {
+            bits ^= eng();
+        }
+    }
+    auto t1 = clock_type::now();
+    Report(name + "_raw64", "number", reps/2, Seconds(t0, t1));
+    std::uniform_real_distribution<double> uni(0.0, 1.0);
+    double sum = 0.0;
+    t0 = clock_type::now();
+    for (std::size_t r = 0; r < reps; ++r) {
+        sum += uni(eng);
+    }
+    t1 = clock_type::now();
+    Report(name + "_uniform", "number", reps, Seconds(t0, t1));
+    std::normal_distribution<double> nrm(0.0, 1.0);
+    t0 = clock_type::now();
+    for (std::size_t r = 0; r < reps; ++r) {
+        sum += nrm(eng);
+    }
+    t1 = clock_type::now();
+    Report(name + "_normal", "number", reps, Seconds(t0, t1));
+    if (sum == 0.123456789 || bits == 123456789) std::cerr << sum;
+}
+
+// iteration over a two-sex subpopulation container in which three quarters
+// of the individuals have died (in random order), by testing the alive flag
+// of each position and by scanning the bits of living positions, and the
+// rebuilding of index arrays and compaction of the container
+void BenchSubPop()
+{
+    using sp2_type = SubPop2<ind_type>;
+    const std::size_t max_inds = 100000;
+    const std::size_t reps = 200;
+    sp2_type sp(max_inds);
+    std::mt19937 eng(12345);
+    for (std::size_t i = 0; i < max_inds; ++i) {
+        ind_type indi;
+        indi.SetCol(0, 1.0);
+        indi.SetFemale(i % 2 == 0);
+        sp.Add(indi);
+    }
+    std::vector<std::size_t> idx(max_inds);
+    for (std::size_t i = 0; i < max_inds; ++i) idx[i] = i;
+    std::shuffle(idx.begin(), idx.end(), eng);
+    for (std::size_t k = 0; k < 3*max_inds/4; ++k) sp.Remove(idx[k]);
+    double sum = 0.0;
+    auto t0 = clock_type::now();
+    for (std::size_t r = 0; r < reps; ++r) {
+        for (std::size_t i = 0; i < sp.Iend(); ++i) {
+            if (sp[i].Alive()) sum += sp[i].Col(0);
+        }
+    }
+    auto t1 = clock_type::now();
+    Report("subpop_iter_flag", "individual", reps*sp.NumInds(),
+           Seconds(t0, t1));
+    t0 = clock_type::now();
+    for (std::size_t r = 0; r < reps; ++r) {
+        sp.ForEachLive([&sp, &sum](std::size_t i) { sum += sp[i].Col(0); });
+    }
+    t1 = clock_type::now();
+    Report("subpop_iter_bits", "individual", reps*sp.NumInds(),
+           Seconds(t0, t1));
+    SubPopStruct2<sp2_type> sps(sp);
+    t0 = clock_type::now();
+    for (std::size_t r = 0; r < reps; ++r) {
+        sps.Assign(sp);
+        sum += sps.IndexF(0);
+    }
+    t1 = clock_type::now();
+    Report("subpop_struct", "individual", reps*sp.NumInds(),
+           Seconds(t0, t1));
+    std::size_t n = sp.NumInds();
+    t0 = clock_type::now();
+    sp.Compact();
+    t1 = clock_type::now();
+    Report("subpop_compact", "individual", n, Seconds(t0, t1));
+    if (sp.CountLive() != n || sp.CountFemale() != sp.Nf() ||
+        sp.Iend() != n) {
+        std::cerr << "subpop_compact: wrong counts after compaction\n";
+    }
+    if (sum == 0.123456789) std::cerr << sum;
+}
+
+void BenchKernels(const std::string& dir)
+{
+    std::string inpname = dir + "/bench_kernels.inp";
+    {
+        std::ofstream inp(inpname.c_str());
+        inp << BenchInp << "OutName = " << dir << "/bench_kernels.txt\n";
+    }
+    EvoInpData id(inpname.c_str());
+    if (!id.OK) {
+        std::cerr << "Cannot set up kernel benchmarks\n";
+        return;
+    }
+    // keep the table on std::cout free from messages from Evo
+    std::streambuf* sb = std::cout.rdbuf(nullptr);
+    Evo evo(id);
+    std::cout.rdbuf(sb);
+    for (std::size_t g : {2, 3, 10}) {
+        BenchInteract(id, g);
+    }
+    PayoffModels::ForEach([&id](auto tag) {
+        BenchUpdatePayoff<typename decltype(tag)::type>(id);
+    });
+    BenchGetGamete(id);
+    BenchReproduce(id, evo);
+    BenchRandEng<std::mt19937>();
+    BenchRandEng<Xoshiro256pp>();
+    BenchRandEng<Philox4x32>();
+    BenchSubPop();
+}
+
+
+//******************************** Files *********************************
+
+void BenchWriters(const metapop_type& pop, std::size_t rows,
+                  const std::string& dir)
+{
+    std::string name = dir + "/bench_pop";
+    auto t0 = clock_type::now();
+    WriteStream(pop, name + "_stream.txt");
+    auto t1 = clock_type::now();
+    Report("write_ostream", rows, Seconds(t0, t1), name + "_stream.txt");
+
+    t0 = clock_type::now();
+    pop.Write_to_File(name + "_p6.txt", 6);
+    t1 = clock_type::now();
+    Report("write_text_prec6", rows, Seconds(t0, t1), name + "_p6.txt");
+
+    t0 = clock_type::now();
+    pop.Write_to_File(name + "_exact.txt", 0);
+    t1 = clock_type::now();
+    Report("write_text_exact", rows, Seconds(t0, t1), name + "_exact.txt");
+
+#ifdef PGG_ZLIB
+    t0 = clock_type::now();
+    pop.Write_to_File(name + "_p6.txt.gz", 6);
+    t1 = clock_type::now();
+    Report("write_text_prec6_gz", rows, Seconds(t0, t1), name + "_p6.txt.gz");
+#endif
+
+    t0 = clock_type::now();
+    pop.Write_to_File(name + ".pgb");
+    t1 = clock_type::now();
+    Report("write_binary", rows, Seconds(t0, t1), name + ".pgb");
+}
+
+// the reader used in earlier versions of the program
+std::size_t ReadStream(metapop_type& pop, const std::string& infilename)
+{
+    std::ifstream infile(infilename.c_str());
+    char c = '\0';
+    while (c != '\n' && infile) infile.get(c);
+    std::size_t n = 0;
+    ind_type indi;
+    while (infile >> indi) {
+        pop[indi.SubPopNum()].Add(indi);
+        ++n;
+    }
+    return n;
+}
+
+void BenchReaders(std::size_t rows, const std::string& dir)
+{
+    std::string name = dir + "/bench_pop";
+    std::size_t max_inds = (rows + NumSubPops - 1)/NumSubPops;
+    metapop_type pop(NumSubPops, max_inds);
+    auto t0 = clock_type::now();
+    ReadStream(pop, name + "_p6.txt");
+    auto t1 = clock_type::now();
+    Report("read_istream", rows, Seconds(t0, t1), name + "_p6.txt");
+
+    pop.Assign(NumSubPops, max_inds);
+    t0 = clock_type::now();
+    pop.Read_from_File(name + "_p6.txt", rows);
+    t1 = clock_type::now();
+    Report("read_text", rows, Seconds(t0, t1), name + "_p6.txt");
+
+    pop.Assign(NumSubPops, max_inds);
+    t0 = clock_type::now();
+    pop.Read_from_File(name + ".pgb", rows);
+    t1 = clock_type::now();
+    Report("read_binary", rows, Seconds(t0, t1), name + ".pgb");
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    std::size_t num_inds = (argc > 1) ? std::stoul(argv[1]) : 200000;
+    std::string dir = (argc > 2) ? argv[2] : ".";
+    metapop_type pop = MakePop(num_inds);
+    std::cout << "bench\tunit\tcount\tseconds\tns_per_unit\tMB\tMB_per_s\n";
+    BenchKernels(dir);
+    BenchWriters(pop, num_inds, dir);
+    BenchReaders(num_inds, dir);
+    return 0;
+}
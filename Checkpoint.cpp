@@ -0,0 +1,85 @@
+#include "Checkpoint.hpp"
+#include <cstring>
+#include <vector>
+#include <unistd.h>
+
+// The EvoProg program runs actor-critic learning simulations
+// Copyright (C) 2019  Olof Leimar
+// See Readme.md for copyright notice
+
+namespace {
+
+const char Magic[8] = {'P', 'G', 'G', 'C', 'K', 'P', 'T', '\0'};
+const std::size_t HeaderSize = 32;
+const std::size_t PopAlign = 64;
+
+} // namespace
+
+bool WriteCkptFile(const std::string& filename,
+                   const std::string& meta,
+                   const std::function<bool(std::FILE*)>& write_pop)
+{
+    std::string tmpname = filename + ".tmp";
+    std::FILE* fp = std::fopen(tmpname.c_str(), "wb");
+    if (!fp) return false;
+    std::uint64_t meta_size = meta.size();
+    std::uint64_t pop_off =
+        ((HeaderSize + meta_size + PopAlign - 1)/PopAlign)*PopAlign;
+    std::vector<char> head(pop_off, '\0');
+    std::uint32_t unused = 0;
+    std::memcpy(&head[0], Magic, sizeof(Magic));
+    std::memcpy(&head[8], &CkptVersion, 4);
+    std::memcpy(&head[12], &unused, 4);
+    std::memcpy(&head[16], &meta_size, 8);
+    std::memcpy(&head[24], &pop_off, 8);
+    std::memcpy(&head[HeaderSize], meta.data(), meta_size);
+    bool OK = std::fwrite(head.data(), 1, head.size(), fp) == head.size();
+    OK = OK && write_pop(fp);
+    // make sure data are on disk before the rename
+    OK = OK && std::fflush(fp) == 0 && fsync(fileno(fp)) == 0;
+    if (std::fclose(fp) != 0) OK = false;
+    OK = OK && std::rename(tmpname.c_str(), filename.c_str()) == 0;
+    if (!OK) std::remove(tmpname.c_str());
+    return OK;
+}
+
+
+//*************************** Class CkptFile *****************************
+
+CkptFile::CkptFile(const std::string& filename) :
+    mf(filename),
+    ok{false}
+{
+    if (!mf) {
+        err = "could not open file";
+        return;
+    }
+    const char* data = mf.Data();
+    if (mf.Size() < HeaderSize ||
+        std::memcmp(data, Magic, sizeof(Magic)) != 0) {
+        err = "not a checkpoint file";
+        return;
+    }
+    std::uint32_t version = 0;
+    std::uint64_t meta_size = 0;
+    std::uint64_t pop_off = 0;
+    std::memcpy(&version, data + 8, 4);
+    std::memcpy(&meta_size, data + 16, 8);
+    std::memcpy(&pop_off, data + 24, 8);
+    if (version != CkptVersion) {
+        err = "unsupported checkpoint version";
+        return;
+    }
+    if (HeaderSize + meta_size > pop_off || pop_off > mf.Size() ||
+        pop_off % 8 != 0) {
+        err = "checkpoint file is truncated or invalid";
+        return;
+    }
+    meta.assign(data + HeaderSize, meta_size);
+    pbv.reset(new PopBinView(data + pop_off, mf.Size() - pop_off));
+    if (!pbv->OK()) {
+        err = pbv->Error();
+        return;
+    }
+    ok = true;
+}
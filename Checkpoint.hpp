@@ -0,0 +1,61 @@
+#ifndef CHECKPOINT_HPP
+#define CHECKPOINT_HPP
+
+#include "PopBinFile.hpp"
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <string>
+
+// The EvoProg program runs actor-critic learning simulations
+// Copyright (C) 2019  Olof Leimar
+// See Readme.md for copyright notice
+
+// This unit implements checkpoint files, used to continue a long run after
+// an interruption. A checkpoint file contains a text part (meta data, such as
+// the generation number, the states of random number engines, and the input
+// parameters) followed by the population in the binary format described in
+// PopBinFile.hpp.
+//
+// Layout (integers are unsigned and in native byte order):
+//   char     magic[8]     "PGGCKPT" followed by '\0'
+//   uint32   version
+//   uint32   (unused)
+//   uint64   size in bytes of the meta data text
+//   uint64   offset in bytes of the population data (a multiple of 64)
+//   char[]   meta data text
+//   (padding up to the population offset)
+//   binary population data
+
+const std::uint32_t CkptVersion = 1;
+
+// Write a checkpoint file: the meta data text is followed by the population,
+// written to the open file by write_pop (which returns true on success). The
+// file is first written under a temporary name, which is then renamed to
+// filename, so that a previous checkpoint is replaced only by a complete new
+// one.
+bool WriteCkptFile(const std::string& filename,
+                   const std::string& meta,
+                   const std::function<bool(std::FILE*)>& write_pop);
+
+
+//*************************** Class CkptFile *****************************
+
+// Reads (memory maps) a checkpoint file
+
+class CkptFile {
+public:
+    explicit CkptFile(const std::string& filename);
+    bool OK() const { return ok; }
+    const std::string& Error() const { return err; }
+    const std::string& Meta() const { return meta; }
+    const PopBinView& Pop() const { return *pbv; }
+private:
+    MappedFile mf;
+    bool ok;
+    std::string err;
+    std::string meta;
+    std::unique_ptr<PopBinView> pbv;
+};
+
+#endif // CHECKPOINT_HPP
@@ -1,20 +1,53 @@
-#include "EvoCode.hpp"
+#include "PggSim.h"
+#include "PggServer.hpp"
 #include <iostream>
+#include <string>
 
 // The EvoProg program runs actor-critic learning simulations
 // Copyright (C) 2019  Olof Leimar
 // See Readme.md for copyright notice
 
+// EvoProg.exe runs a simulation through the API of libpggsim (see PggSim.h)
+
 int main(int argc, char* argv[])
 {
+    // option --resume continues from the checkpoint given in the input file,
+    // and --serve (or --serve=socket_path) keeps the simulation in memory
+    // and takes commands (see PggServer.hpp)
+    int flags = 0;
+    bool serve = false;
+    std::string socket_path;
+    for (int i = 2; i < argc; ++i) {
+        std::string arg(argv[i]);
+        if (arg == "--resume") flags |= PGG_RESUME;
+        if (arg == "--serve") serve = true;
+        if (arg.compare(0, 8, "--serve=") == 0) {
+            serve = true;
+            socket_path = arg.substr(8);
+        }
+    }
+    // serving on standard input, replies go to standard output, and all
+    // messages to standard error
+    std::streambuf* out_buf = std::cout.rdbuf();
+    std::ostream out(out_buf);
+    if (serve && socket_path.empty()) std::cout.rdbuf(std::cerr.rdbuf());
     // Open input file and read indata
-    EvoInpData eid(argv[1]);
-    if (!eid.OK) {
+    pgg_sim* sim = (argc > 1) ? pgg_create_from_file(argv[1], flags) : nullptr;
+    if (!sim) {
         std::cout << "Input failed!" << "\n";
+        std::cout.rdbuf(out_buf);
         return -1;
     }
-    // Run the iteration
-    Evo evo(eid);
-    evo.Run();
-    return 0;
+    int res = 0;
+    if (!serve) {
+        // Run the iteration
+        pgg_run(sim);
+    } else if (socket_path.empty()) {
+        res = ServeStdio(sim, out);
+    } else {
+        res = ServeSocket(sim, socket_path);
+    }
+    pgg_destroy(sim);
+    std::cout.rdbuf(out_buf);
+    return res;
 }
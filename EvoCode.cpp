@@ -1,12 +1,19 @@
 #include "EvoCode.hpp"
 #include "InpFile.hpp"
 #include "Utils.hpp"
+#include "Checkpoint.hpp"
+#include "TextReader.hpp"
 #include <algorithm>
 #include <vector>
 #include <string>
 #include <cmath>
 #include <fstream>
+#include <memory>
+#include <sstream>
+#include <chrono>
 #include <climits> // for UCHAR_MAX and UINT_MAX
+#include <charconv>
+#include <unistd.h>
 
 #ifdef PARA_RUN
 #include <omp.h>
@@ -19,6 +26,7 @@
 //************************** Class EvoInpData ****************************
 
 EvoInpData::EvoInpData(const char* filename) :
+      Resume(false),
       OK(false)
 {
     InpFile inp(filename);
@@ -26,6 +34,26 @@ EvoInpData::EvoInpData(const char* filename) :
         std::cout << "Failed to open " << inp.GetFileName() << '\n';
         return;
     }
+    // keep the input parameters, for checkpoints
+    std::ifstream inpf(inp.GetFileName());
+    std::ostringstream inps;
+    inps << inpf.rdbuf();
+    InpText = inps.str();
+    ReadInp(inp);
+}
+
+EvoInpData::EvoInpData(const std::string& text, const std::string& name) :
+      Resume(false),
+      OK(false)
+{
+    std::istringstream is(text);
+    InpFile inp(is, name);
+    InpText = text;
+    ReadInp(inp);
+}
+
+void EvoInpData::ReadInp(const InpFile& inp)
+{
     Read(inp, max_num_thrds, "max_num_thrds");
     Read(inp, nsp, "nsp");
     Read(inp, ngsp, "ngsp");
@@ -50,6 +78,49 @@ EvoInpData::EvoInpData(const char* filename) :
     ReadArr(inp, max_val, "max_val");
     ReadArr(inp, min_val, "min_val");
     ReadArr(inp, rho, "rho");
+    ReadStringOpt(inp, MigModel, "MigModel", "island");
+    if (MigModel != "island" && MigModel != "stepping") {
+        std::cout << "Unknown MigModel " << MigModel
+                  << " (available: island stepping)\n";
+        return;
+    }
+    ReadOpt(inp, MigRate, "MigRate", 1.0);
+    if (MigRate < 0.0 || MigRate > 1.0) {
+        std::cout << "MigRate must be between 0 and 1\n";
+        return;
+    }
+    ReadStringOpt(inp, PayoffModel, "PayoffModel", QuadPayoff::Name);
+    if (!PayoffModels::Contains(PayoffModel)) {
+        std::cout << "Unknown PayoffModel " << PayoffModel
+                  << " (available: " << PayoffModels::Names() << ")\n";
+        return;
+    }
+    ReadOpt(inp, Athr, "Athr", 1.0);
+    ReadOpt(inp, Bthr, "Bthr", 0.0);
+    ReadOpt(inp, Kexp, "Kexp", 2.0);
+    ReadStringOpt(inp, RunMode, "RunMode", "evolve");
+    if (RunMode != "evolve" && RunMode != "invasion") {
+        std::cout << "Unknown RunMode " << RunMode
+                  << " (available: evolve invasion)\n";
+        return;
+    }
+    ReadOpt(inp, InvReps, "InvReps", 10000);
+    if (InvReps == 0) InvReps = 1;
+    ReadOpt(inp, InvDelta, "InvDelta", 0.01);
+    ReadOpt(inp, InvSteps, "InvSteps", 0);
+    ReadOpt(inp, InvRate, "InvRate", 1.0);
+    ReadOpt(inp, InvTolSE, "InvTolSE", 2.0);
+    ReadOpt(inp, LCache, "LCache", false);
+    ReadOpt(inp, LCacheSpec.step, "LCacheStep", 0.01);
+    ReadOpt(inp, LCacheSpec.max_samples, "LCacheSamples", 16);
+    ReadOpt(inp, LCacheSpec.min_samples, "LCacheMin", 4);
+    ReadOpt(inp, LCacheSpec.explore, "LCacheExplore", 0.05);
+    ReadOpt(inp, LCacheSpec.max_age, "LCacheMaxAge", 0);
+    ReadOpt(inp, LCacheSpec.max_keys, "LCacheMaxKeys", 100000);
+    if (LCache && (LCacheSpec.step <= 0.0 || LCacheSpec.max_samples == 0)) {
+        std::cout << "LCacheStep and LCacheSamples must be positive\n";
+        return;
+    }
     Read(inp, ReadFromFile, "ReadFromFile");
     cont_gen = false;
     if ( ReadFromFile ) {
@@ -59,6 +130,74 @@ EvoInpData::EvoInpData(const char* filename) :
         ReadArr(inp, all0, "all0");
     }
     ReadString(inp, OutName, "OutName");
+    ReadOpt(inp, OutPrec, "OutPrec", 6);
+    if (OutPrec < 0 || OutPrec > 17) {
+        // 17 significant digits are enough to represent any double
+        std::cout << "OutPrec must be from 0 to 17\n";
+        return;
+    }
+    ReadStringOpt(inp, OutCols, "OutCols", "");
+    ReadOpt(inp, OutSample, "OutSample", 1.0);
+    if (!(OutSample > 0.0 && OutSample <= 1.0)) {
+        std::cout << "OutSample must be above 0 and at most 1\n";
+        return;
+    }
+    ReadOpt(inp, DumpEvery, "DumpEvery", 0);
+    std::vector<std::size_t> cols;
+    if (!Evo::metapop_type::ColIndices(OutCols, cols)) return;
+    ReadStringOpt(inp, StatName, "StatName", "");
+    ReadOpt(inp, StatSubPops, "StatSubPops", true);
+    ReadOpt(inp, StatEvery, "StatEvery", 1);
+    if (StatEvery == 0) StatEvery = 1;
+    ReadStringOpt(inp, CkptName, "CkptName", OutName + ".ckpt");
+    ReadStringOpt(inp, InvName, "InvName", OutName + ".inv");
+    ReadOpt(inp, CkptEvery, "CkptEvery", 0);
+    ReadOpt(inp, CkptMinutes, "CkptMinutes", 0.0);
+    ReadStringOpt(inp, SnapName, "SnapName", "");
+    ReadOpt(inp, SnapEvery, "SnapEvery", 1);
+    if (SnapEvery == 0) SnapEvery = 1;
+    ReadStringOpt(inp, SnapCols, "SnapCols", "");
+    if (!Evo::metapop_type::ColIndices(SnapCols, cols)) return;
+    ReadStringOpt(inp, ProfName, "ProfName", "");
+    ReadOpt(inp, UsePerf, "PerfCounters", false);
+    ReadOpt(inp, Seed, "Seed", 0u);
+    // the engine is chosen when compiling (see RandEng.hpp); an input file
+    // can state which engine it expects
+    ReadStringOpt(inp, RandEngine, "RandEng", EngineName<RandEng>());
+    if (RandEngine != EngineName<RandEng>()) {
+        std::cout << "RandEng " << RandEngine << " requested, but this "
+                  << "program was built with " << EngineName<RandEng>()
+                  << " (rebuild with make RANDENG=" << RandEngine << ")\n";
+        return;
+    }
+    ReadStringOpt(inp, StatusName, "StatusName", "");
+    ReadOpt(inp, StatusPort, "StatusPort", 0);
+    ReadStringOpt(inp, TraceName, "TraceName", "");
+    ReadOpt(inp, TraceLevel, "TraceLevel", 2);
+    ReadOpt(inp, TraceEvery, "TraceEvery", 1);
+    if (TraceEvery == 0) TraceEvery = 1;
+    ReadOpt(inp, TraceEvents, "TraceEvents", 100000);
+    if (TraceEvents == 0) TraceEvents = 1;
+    if (UsePerf && ProfName.empty()) {
+        std::cout << "PerfCounters requires ProfName, counters not used\n";
+        UsePerf = false;
+    }
+    ReadStringOpt(inp, TreeName, "TreeName", "");
+    ReadOpt(inp, TreeSimplify, "TreeSimplify", 10);
+    if (TreeSimplify == 0) TreeSimplify = 1;
+    ReadStringOpt(inp, StoreName, "StoreName", "");
+    ReadOpt(inp, StoreMB, "StoreMB", 1024.0);
+    ReadOpt(inp, MemLimit, "MemLimit", 0.0);
+    if (!StoreName.empty()) {
+        // the population is generated from all0 and streamed through the
+        // store, and the output is written in parts as text
+        if (ReadFromFile || RunMode != "evolve" || IsPopBinName(OutName) ||
+            MigRate < 1.0) {
+            std::cout << "StoreName requires ReadFromFile = 0, RunMode = "
+                      << "evolve, MigRate = 1 and text output (OutName)\n";
+            return;
+        }
+    }
 
     InpName = std::string(inp.GetFileName());
     OK = true;
@@ -67,6 +206,78 @@ EvoInpData::EvoInpData(const char* filename) :
 
 //****************************** Class Evo *****************************
 
+namespace {
+
+// file name for a population dump in generation gen, constructed by
+// inserting _g<gen> before the extension of name (before .txt in .txt.gz)
+std::string DumpFileName(const std::string& name, int gen)
+{
+    std::string base = name;
+    std::string ext;
+    if (TextWriter::IsCompressedName(base)) {
+        ext = base.substr(base.size() - 3);
+        base.erase(base.size() - 3);
+    }
+    std::size_t dot = base.find_last_of('.');
+    std::size_t slash = base.find_last_of('/');
+    if (dot != std::string::npos &&
+        (slash == std::string::npos || dot > slash)) {
+        ext = base.substr(dot) + ext;
+        base.erase(dot);
+    }
+    return base + "_g" + std::to_string(gen) + ext;
+}
+
+// length of the start of a statistics file (the header and the rows, which
+// are in the order of generations) that belongs to generations up to gen;
+// an incomplete last line, from an interrupted write, is not kept
+std::size_t StatsKeep(const char* text, std::size_t size, int gen)
+{
+    std::size_t end = size;
+    while (end > 0 && text[end - 1] != '\n') --end;
+    while (end > 0) {
+        std::size_t beg = end - 1;
+        while (beg > 0 && text[beg - 1] != '\n') --beg;
+        if (beg == 0) return end; // the header
+        int g = 0;
+        std::from_chars_result res = std::from_chars(text + beg,
+                                                     text + end, g);
+        if (res.ec == std::errc() && g <= gen) return end;
+        end = beg;
+    }
+    return 0;
+}
+
+// prepare the statistics file filename for a run that continues after
+// generation gen, by removing rows of later generations (written after the
+// checkpoint of a resumed run); returns false if the file is missing or
+// empty, so that it should be written from the start, with the header
+bool TrimStats(const std::string& filename, int gen)
+{
+    std::string kept;
+    std::size_t size = 0;
+    std::size_t keep = 0;
+    {
+        TextBuffer tb(filename);
+        if (!tb) return false;
+        size = tb.Size();
+        keep = StatsKeep(tb.Data(), size, gen);
+        if (keep == 0 || keep == size) return keep > 0;
+        if (TextWriter::IsCompressedName(filename)) {
+            kept.assign(tb.Data(), keep);
+        }
+    }
+    if (!TextWriter::IsCompressedName(filename)) {
+        return truncate(filename.c_str(), static_cast<off_t>(keep)) == 0;
+    }
+    // a compressed file is written again
+    TextWriter tw(filename);
+    tw.Put(kept);
+    return tw.Close();
+}
+
+} // namespace
+
 Evo::Evo(const EvoInpData& eid) :
     id{eid},
     nsp{id.nsp},
@@ -78,12 +289,8 @@ Evo::Evo(const EvoInpData& eid) :
     N{ng*g},
     T{id.T},
     numgen{id.numgen},
-    B0{id.B0},
-    B1{id.B1},
-    B2{id.B2},
-    K1{id.K1},
-    K11{id.K11},
-    K12{id.K12},
+    pay_pars{id.B0, id.B1, id.B2, id.K1, id.K11, id.K12,
+             id.Athr, id.Bthr, id.Kexp},
     sigma{id.sigma},
     alphaw{id.alphaw},
     alphatheta{id.alphatheta},
@@ -92,27 +299,64 @@ Evo::Evo(const EvoInpData& eid) :
     qv{id.qv},
     num_thrds{1},
     sds(id.max_num_thrds),
+    start_gen{0},
     popOK{true},
-    pop(nsp, max_inds),
-    next_pop(nsp, max_inds)
+    pop(id.StoreName.empty() ? nsp : 0, max_inds),
+    next_pop(id.StoreName.empty() ? nsp : 0, max_inds),
+    learn_st(nsp),
+    repro_st(nsp)
 {
     // decide on number of threads for parallel processing
     // (if PARA_RUN is undefined, the program is single-threaded)
 #ifdef PARA_RUN
-    num_thrds = omp_get_max_threads();
-    if (num_thrds > id.max_num_thrds) num_thrds = id.max_num_thrds;
-    // check that there is at least one subpopulation per thread
-    if (num_thrds > nsp) num_thrds = nsp;
+    num_thrds = NumThreads(id);
     std::cout << "Number of threads: "
               << num_thrds << '\n';
 #endif
-    // generate one seed for each thread
+    // generate one seed for each thread (a given Seed makes a run
+    // reproducible, for the same number of threads)
     std::random_device rd;
     for(int i = 0; i < num_thrds; ++i) {
-        sds[i] = rd();
+        sds[i] = (id.Seed != 0) ? id.Seed + i : rd();
+    }
+    // set up one random number engine and one mutation record per thread;
+    // they are kept between generations, so that their states can be saved
+    // in checkpoints (engines with jump() give each thread a separate part
+    // of one stream, see RandEng.hpp)
+    engs = ThreadEngines<rand_eng>(sds, num_thrds);
+    mrs.reserve(num_thrds);
+    for (int i = 0; i < num_thrds; ++i) {
+        // set up mutation record, with parameters controlling mutation,
+        // segregation and recombination
+        mrs.emplace_back(engs[i]);
+        mut_rec_type& mr = mrs.back();
+        mr.mut_rate = id.mut_rate;
+        mr.SD = id.SD;
+        mr.max_val = id.max_val;
+        mr.min_val = id.min_val;
+        mr.rho = id.rho;
     }
-    // check if population data should be read from file
-    if (id.ReadFromFile) {
+    // columns, sampling and precision for population output
+    metapop_type::ColIndices(id.OutCols, out_spec.cols);
+    out_spec.sample_rate = id.OutSample;
+    out_spec.seed = (id.Seed != 0) ? id.Seed : rd();
+    mig_seed = (id.Seed != 0) ? id.Seed : rd();
+    out_spec.prec = id.OutPrec;
+    // columns for snapshots (all individuals are included)
+    metapop_type::ColIndices(id.SnapCols, snap_spec.cols);
+    // keep the input parameters, for checkpoints
+    inp_text = id.InpText;
+    // check if the run should continue from a checkpoint, or if population
+    // data should be read from file
+    if (!id.StoreName.empty()) {
+        // the starting population is written to the store in RunStored
+        if (id.Resume) {
+            std::cout << "Checkpoints are not available with StoreName\n";
+            popOK = false;
+        }
+    } else if (id.Resume) {
+        popOK = ReadCheckpoint();
+    } else if (id.ReadFromFile) {
         popOK = pop.Read_from_File(id.InName, ng*g);
     } else {
         // construct all individuals as essentially the same
@@ -134,43 +378,552 @@ Evo::Evo(const EvoInpData& eid) :
     }
 }
 
+std::size_t Evo::NumThreads(const EvoInpData& eid)
+{
+    std::size_t nt = 1;
+#ifdef PARA_RUN
+    nt = omp_get_max_threads();
+    if (nt > eid.max_num_thrds) nt = eid.max_num_thrds;
+    // check that there is at least one subpopulation per thread
+    if (nt > eid.nsp) nt = eid.nsp;
+#endif
+    return nt;
+}
+
+namespace {
+
+// bytes of an entry (key and outcomes) of a learning-outcome cache that
+// holds max_samples outcomes of groups of g
+template<typename PhenType>
+double CacheEntryBytes(const LearnCacheSpec& spec, std::size_t g)
+{
+    // a key has 4 values per member, and each entry also has the overhead
+    // of its node in the hash table
+    return g*4*sizeof(std::int32_t) + 64.0
+        + spec.max_samples*(g*sizeof(PhenType) + sizeof(int));
+}
+
+double PopBytes(const Evo::metapop_type& pop)
+{
+    double bytes = 0.0;
+    for (std::size_t n = 0; n < pop.NumPops(); ++n) {
+        bytes += pop[n].ind.capacity()*sizeof(Evo::ind_type);
+    }
+    return bytes;
+}
+
+} // namespace
+
+MemReport Evo::PredictMem(const EvoInpData& eid, std::size_t num_thrds)
+{
+    // these follow the allocations in the constructor and in RunModel (or
+    // RunStored); the individuals themselves have a fixed size, with
+    // NumLoci alleles in each of their two gametes
+    const double nt = static_cast<double>(num_thrds);
+    const double Ns = static_cast<double>(eid.ngsp*eid.g);
+    const double N = eid.nsp*Ns;
+    const double ind_bytes = sizeof(ind_type);
+    const bool evolve = eid.RunMode == "evolve";
+    const bool in_memory = eid.StoreName.empty();
+    MemReport mem;
+    if (in_memory) {
+        mem.Add("pop", N*ind_bytes);
+        mem.Add("next_pop", N*ind_bytes);
+    } else {
+        mem.Add("store", eid.StoreMB*1.0e6);
+    }
+    if (evolve && in_memory) {
+        // thread-local copies of the subpopulations, and, per thread, the
+        // offspring of one subpopulation, with the weights of parents
+        mem.Add("popl", N*ind_bytes);
+        mem.Add("offspring", nt*Ns*(ind_bytes + 2*sizeof(double)));
+        if (eid.MigRate < 1.0) {
+            // queues between threads, and migrants a thread sends itself
+            std::size_t per_thr = eid.nsp/num_thrds;
+            double cap = std::ceil(eid.MigRate*Ns)
+                *(eid.nsp - (num_thrds - 1)*per_thr);
+            mem.Add("migration", (nt*nt*(cap + 1) + nt*cap)
+                    *sizeof(MigExchange<ind_type>::Msg));
+        }
+    }
+    mem.Add("engines", nt*(sizeof(rand_eng) + sizeof(mut_rec_type)));
+    // output (and population dumps) through a TextWriter, with the rows of
+    // each subpopulation to write, and statistics and snapshots, if any
+    double io = TextWriter::DefBlockSize + N*sizeof(std::size_t);
+    if (!eid.StatName.empty()) io += TextWriter::DefBlockSize;
+    if (!eid.SnapName.empty()) {
+        std::vector<std::size_t> cols;
+        metapop_type::ColIndices(eid.SnapCols, cols);
+        std::size_t ncols = cols.empty() ? ind_type::num_cols : cols.size();
+        io += N*ncols*sizeof(double);
+    }
+    mem.Add("io", io);
+    if (!eid.TraceName.empty()) {
+        mem.Add("trace", nt*eid.TraceEvents*sizeof(TraceEvent));
+    }
+    if (eid.LCache) {
+        // each cache can grow to max_keys entries
+        mem.Add("cache", nt*eid.LCacheSpec.max_keys
+                *CacheEntryBytes<phen_type>(eid.LCacheSpec, eid.g));
+    }
+    if (!eid.TreeName.empty()) {
+        // nodes and edges recorded between simplifications (each gamete
+        // gives at most NumLoci edges), with room for the growth of their
+        // vectors, in addition to the simplified genealogy, and the gids of
+        // pop and next_pop
+        double gens = std::min(eid.TreeSimplify, eid.numgen) + 1;
+        mem.Add("genealogy", 2*gens*2*N
+                *(sizeof(std::int32_t) + NumLoci*sizeof(TsEdge))
+                + 2*N*sizeof(std::uint64_t));
+    }
+    return mem;
+}
+
+bool Evo::CheckMem(const EvoInpData& eid)
+{
+    MemReport pred = PredictMem(eid, NumThreads(eid));
+    pred.Write(std::cout, "predicted");
+    double limit = (eid.MemLimit > 0.0) ? eid.MemLimit*1.0e6 : PhysMem();
+    if (limit > 0.0 && pred.Total() > limit) {
+        std::cout << "The run needs about " << pred.Total()/1.0e6
+                  << " MB, which exceeds "
+                  << (eid.MemLimit > 0.0 ? "MemLimit = " : "the memory of "
+                      "this computer, ")
+                  << limit/1.0e6 << " MB\n";
+        return false;
+    }
+    return true;
+}
+
+MemReport Evo::HeldMem() const
+{
+    MemReport pred = PredictMem(id, num_thrds);
+    MemReport held;
+    for (const auto& it : pred.Items()) {
+        const std::string& name = it.first;
+        double bytes = it.second;
+        if (name == "pop") {
+            bytes = PopBytes(pop);
+        } else if (name == "next_pop") {
+            bytes = PopBytes(next_pop);
+        } else if (name == "engines") {
+            bytes = engs.capacity()*sizeof(rand_eng)
+                + mrs.capacity()*sizeof(mut_rec_type);
+        } else if (name == "cache") {
+            bytes = 0.0;
+            for (const auto& lc : lcaches) {
+                bytes += lc.NumKeys()
+                    *CacheEntryBytes<phen_type>(id.LCacheSpec, g);
+            }
+        } else if (name == "genealogy") {
+            bytes = tseq.MaxNodes()*sizeof(std::int32_t)
+                + tseq.NumEdges()*sizeof(TsEdge);
+            for (std::size_t n = 0; n < pop_gids.size(); ++n) {
+                bytes += (pop_gids[n].capacity() + next_gids[n].capacity())
+                    *sizeof(std::uint64_t);
+            }
+        }
+        held.Add(name, bytes);
+    }
+    return held;
+}
+
+// report the memory held at the end of a run
+void Evo::WriteMem() const
+{
+    HeldMem().Write(std::cout, "end of run", PeakRSS());
+}
+
 void Evo::Run()
 {
+    if (id.RunMode == "invasion") {
+        RunInvasion();
+        WriteMem();
+        return;
+    }
+    if (!id.StoreName.empty()) {
+        RunStored();
+        WriteMem();
+        return;
+    }
+    Step(static_cast<int>(numgen) - start_gen);
+}
+
+bool Evo::StepsAvailable()
+{
+    if (id.RunMode == "invasion" || !id.StoreName.empty()) {
+        std::cout << "Steps are only available for evolution with the "
+                  << "population in memory\n";
+        return false;
+    }
     if (!popOK) {
         std::cout << "Starting population not valid \n";
-        return;
+        return false;
     }
-    Timer timer(std::cout);
-    timer.Start();
-    ProgressBar PrBar(std::cout, numgen);
-#pragma omp parallel num_threads(num_thrds)
-    {
+    return true;
+}
+
+int Evo::Step(int num_gens)
+{
+    if (!StepsAvailable()) return -1;
+    int end_gen = std::min(start_gen + std::max(num_gens, 0),
+                           static_cast<int>(numgen));
+    if (end_gen == start_gen) return 0;
+    int first_gen = start_gen;
+    // select the payoff model, which is a template parameter of the
+    // learning groups (the name has been checked when reading the input)
+    PayoffModels::Dispatch(id.PayoffModel, [this, end_gen](auto tag) {
+        RunModel<typename decltype(tag)::type>(end_gen);
+    });
+    return start_gen - first_gen;
+}
+
+int Evo::Learn(int num_steps)
+{
+    if (!StepsAvailable()) return -1;
+    if (num_steps <= 0) return 0;
+    PayoffModels::Dispatch(id.PayoffModel, [this, num_steps](auto tag) {
+        LearnModel<typename decltype(tag)::type>(num_steps);
+    });
+    return num_steps;
+}
+
+// continue learning in the current groups, as in the first generation of a
+// run with cont_gen = 1 (the engine of a thread is used for a fixed set of
+// subpopulations, so that the results are reproducible)
+template<typename PayoffType>
+void Evo::LearnModel(std::size_t num_steps)
+{
+    using acg_model = ActCritGroup<phen_type, PayoffType>;
+    const PayoffType pay(pay_pars);
+#pragma omp parallel for num_threads(num_thrds) schedule(static)
+    for (long n = 0; n < static_cast<long>(nsp); ++n) {
 #ifdef PARA_RUN
         int threadn = omp_get_thread_num();
 #else
         int threadn = 0;
 #endif
-        // set up thread-local random number engine:
-        rand_eng eng(sds[threadn]);
-        rand_uni uni(0.0, 1.0);
-        rand_int uri(0, Nqv - 1);
-        rand_norm nrm(0.0, 1.0);
-        // set up thread-local mutation record, with parameters controlling
-        // mutation, segregation and recombination
-        mut_rec_type mr(eng);
-        // mr.SetRandEng(eng); // mr will use thread-local engine
+        rand_eng& eng = engs[threadn];
+        subpop_type& sp = pop[n];
+        for (int k = 0; k < ngsp; ++k) {
+            vph_type phen(g);
+            for (int j = 0; j < g; ++j) {
+                phen[j] = sp[k*g + j].phenotype;
+            }
+            acg_model acg(g, num_steps, pay, sigma, alphaw, alphatheta,
+                          lambdatheta, phen);
+            acg.Interact(eng);
+            const vph_type& memb = acg.Get_memb();
+            for (int j = 0; j < g; ++j) {
+                sp[k*g + j].phenotype = memb[j];
+            }
+        }
+    }
+}
+
+namespace {
+
+// read a value of type T from s, returning false if s does not hold one
+template<typename T>
+bool ParseValue(const std::string& s, T& value)
+{
+    std::istringstream ist(s);
+    T v;
+    ist >> v;
+    if (!ist) return false;
+    ist >> std::ws;
+    if (!ist.eof()) return false;
+    value = v;
+    return true;
+}
+
+bool ParseValue(const std::string& s, LocVec& value)
+{
+    std::istringstream ist(s);
+    LocVec v;
+    for (double& x : v) ist >> x;
+    if (!ist) return false;
+    ist >> std::ws;
+    if (!ist.eof()) return false;
+    value = v;
+    return true;
+}
+
+} // namespace
+
+bool Evo::SetParam(const std::string& name, const std::string& value)
+{
+    // learning and payoff parameters, which are used as they are
+    const std::pair<const char*, double*> dpars[] = {
+        {"sigma", &id.sigma}, {"alphaw", &id.alphaw},
+        {"alphatheta", &id.alphatheta}, {"lambdatheta", &id.lambdatheta},
+        {"B0", &id.B0}, {"B1", &id.B1}, {"B2", &id.B2}, {"K1", &id.K1},
+        {"K11", &id.K11}, {"K12", &id.K12}, {"Athr", &id.Athr},
+        {"Bthr", &id.Bthr}, {"Kexp", &id.Kexp}
+    };
+    // parameters of mutation, segregation and recombination
+    const std::pair<const char*, LocVec*> lpars[] = {
+        {"mut_rate", &id.mut_rate}, {"SD", &id.SD},
+        {"max_val", &id.max_val}, {"min_val", &id.min_val},
+        {"rho", &id.rho}
+    };
+    bool ok = false;
+    bool found = false;
+    // whether the outcomes of learning change
+    bool learning = false;
+    for (const auto& dp : dpars) {
+        if (name == dp.first) {
+            found = true;
+            learning = true;
+            ok = ParseValue(value, *dp.second);
+        }
+    }
+    for (const auto& lp : lpars) {
+        if (name == lp.first) {
+            found = true;
+            ok = ParseValue(value, *lp.second);
+        }
+    }
+    if (name == "numgen") {
+        // generations that have been run cannot be undone, at least one
+        // generation must remain (the last one, without reproduction, gives
+        // the output), and a run that has ended cannot be extended, since
+        // its population has learned but not reproduced
+        found = true;
+        std::size_t ngen = 0;
+        ok = static_cast<std::size_t>(start_gen) < numgen &&
+            ParseValue(value, ngen) &&
+            ngen > static_cast<std::size_t>(start_gen);
+        if (ok) id.numgen = ngen;
+    } else if (name == "T") {
+        found = true;
+        learning = true;
+        std::size_t nt = 0;
+        ok = ParseValue(value, nt) && nt > 0;
+        if (ok) id.T = nt;
+    } else if (name == "MigRate") {
+        found = true;
+        double m = 0.0;
+        ok = ParseValue(value, m) && m >= 0.0 && m <= 1.0;
+        if (ok) id.MigRate = m;
+    } else if (name == "MigModel") {
+        found = true;
+        ok = value == "island" || value == "stepping";
+        if (ok) id.MigModel = value;
+    } else if (name == "OutName") {
+        found = true;
+        ok = !value.empty();
+        if (ok) id.OutName = value;
+    } else if (name == "StatName") {
+        found = true;
+        ok = true;
+        id.StatName = value;
+    }
+    if (!found) {
+        std::cout << "Parameter " << name << " cannot be changed\n";
+        return false;
+    }
+    if (!ok) {
+        std::cout << "Invalid value for " << name << ": " << value << '\n';
+        return false;
+    }
+    // update the copies of the parameters used in the run
+    numgen = id.numgen;
+    T = id.T;
+    pay_pars = PayoffPars{id.B0, id.B1, id.B2, id.K1, id.K11, id.K12,
+                          id.Athr, id.Bthr, id.Kexp};
+    sigma = id.sigma;
+    alphaw = id.alphaw;
+    alphatheta = id.alphatheta;
+    lambdatheta = id.lambdatheta;
+    for (mut_rec_type& mr : mrs) {
         mr.mut_rate = id.mut_rate;
         mr.SD = id.SD;
         mr.max_val = id.max_val;
         mr.min_val = id.min_val;
         mr.rho = id.rho;
+    }
+    // the learning-outcome caches hold outcomes for the old parameters
+    // (their keys do not include them), so they are started again, with
+    // new counts of use
+    if (learning) lcaches.clear();
+    return true;
+}
+
+template<typename PayoffType>
+void Evo::RunModel(int end_gen)
+{
+    using acg_model = ActCritGroup<phen_type, PayoffType>;
+    using lcache_type = LearnCache<phen_type>;
+    const PayoffType pay(pay_pars);
+    Timer timer(std::cout);
+    timer.Start();
+    // generations run so far, in previous steps or before a checkpoint
+    const int first_gen = start_gen;
+    const bool appending = first_gen > 0;
+    // per-generation statistics, if requested (a resumed run, or a later
+    // step, appends to the file, after removing any rows written after the
+    // checkpoint, and a new file starts with the header)
+    std::unique_ptr<TextWriter> stat_tw;
+    if (!id.StatName.empty()) {
+        bool stat_append = appending && TrimStats(id.StatName, first_gen);
+        stat_tw.reset(new TextWriter(id.StatName, 6,
+                                     TextWriter::DefBlockSize, stat_append));
+        if (!*stat_tw) {
+            std::cout << "Cannot open " << id.StatName
+                      << ", no statistics will be saved\n";
+            stat_tw.reset();
+        } else if (!stat_append) {
+            stat_tw->Put(StatColHeads());
+            stat_tw->Put('\n');
+        }
+    }
+    // snapshot store, if requested (a resumed run appends to the store,
+    // replacing any snapshots taken after the checkpoint)
+    std::unique_ptr<SnapWriter> snap_w;
+    if (!id.SnapName.empty()) {
+        std::vector<std::string> heads = SplitColHeads(ind_type::ColHeads());
+        std::vector<std::string> names;
+        if (snap_spec.cols.empty()) {
+            names = heads;
+        } else {
+            for (std::size_t c : snap_spec.cols) names.push_back(heads[c]);
+        }
+        snap_w.reset(new SnapWriter(id.SnapName, names, appending));
+        if (snap_w->OK()) snap_w->DropFrom(start_gen + 1);
+        if (!snap_w->OK()) {
+            std::cout << "Snapshot store: " << snap_w->Error()
+                      << ", no snapshots will be saved\n";
+            snap_w.reset();
+        }
+    }
+    // checkpoints, if requested
+    bool ckpt_on = id.CkptEvery > 0 || id.CkptMinutes > 0.0;
+    auto last_ckpt = std::chrono::steady_clock::now();
+    // times of the phases of generations, per thread
+    clocks.assign(num_thrds, PhaseClock());
+    load_bal = LoadBalance(num_thrds);
+    perfs = std::vector<PerfCounters>(num_thrds);
+    traces = std::vector<TraceBuffer>(num_thrds);
+    // (the learning-outcome caches are kept between steps)
+    if (lcaches.size() != (id.LCache ? num_thrds : 0)) {
+        lcaches.assign(id.LCache ? num_thrds : 0,
+                       LearnCache<phen_type>(id.LCacheSpec));
+    }
+    // live status, if requested, with per-thread sums of d and theta after
+    // learning (one slot per cache line)
+    LiveStatus live;
+    if (!id.StatusName.empty() || id.StatusPort > 0) {
+        if (!live.Start(id.StatusName, id.StatusPort)) {
+            std::cout << "Live status: " << live.Error()
+                      << ", no status will be served\n";
+        }
+    }
+    struct alignas(64) LiveSum {
+    // public:
+        double d = 0.0;
+        double theta = 0.0;
+        std::size_t n = 0;
+    };
+    std::vector<LiveSum> live_sums(num_thrds);
+    LiveInfo live_info;
+    live_info.inp_name = id.InpName;
+    live_info.start_gen = start_gen;
+    live_info.numgen = numgen;
+    live_info.thread_steps_per_s.assign(num_thrds, 0.0);
+    auto run_start = std::chrono::steady_clock::now();
+    // structured migration, with mailboxes for migrants between threads
+    // (holding one generation of migrants), if MigRate < 1
+    const bool structured = id.MigRate < 1.0;
+    const bool stepping = id.MigModel == "stepping";
+    const std::size_t per_thr = nsp/num_thrds;
+    auto owner = [per_thr, this](std::size_t n) {
+        return std::min(n/per_thr, num_thrds - 1);
+    };
+    std::size_t mig_cap = static_cast<std::size_t>(std::ceil(id.MigRate*Ns))
+        *(nsp - (num_thrds - 1)*per_thr);
+    MigExchange<ind_type> mig(structured ? num_thrds : 0, mig_cap);
+    // genealogy, if requested, starting from the current population (also
+    // in a resumed run), and continued in later steps
+    const bool rec_tree = !id.TreeName.empty();
+    if (rec_tree && !tseq.Started()) {
+        std::uint64_t first_gid = static_cast<std::uint64_t>(start_gen)*N;
+        pop_gids.assign(nsp, gid_vec_type(Ns));
+        next_gids.assign(nsp, gid_vec_type(Ns));
+        for (std::size_t n = 0; n < nsp; ++n) {
+            for (std::size_t i = 0; i < Ns; ++i) {
+                pop_gids[n][i] = first_gid + n*Ns + i;
+            }
+        }
+        tseq.Start(NumLoci, N, start_gen, first_gid, num_thrds);
+    }
+    ProgressBar PrBar(std::cout, end_gen - first_gen);
+#pragma omp parallel num_threads(num_thrds)
+    {
+#ifdef PARA_RUN
+        int threadn = omp_get_thread_num();
+#else
+        int threadn = 0;
+#endif
+        // use this thread's random number engine and mutation record
+        rand_eng& eng = engs[threadn];
+        mut_rec_type& mr = mrs[threadn];
+        rand_int uri(0, Nqv - 1);
         // determine which subpopulations this thread should handle
         int num_per_thr = nsp/num_thrds;
         int NP1 = threadn*num_per_thr;
         int NP2 = NP1 + num_per_thr;
         if (threadn == num_thrds - 1) NP2 = nsp;
+        PhaseClock& clk = clocks[threadn];
+        // hardware counters, if requested and available, are opened by
+        // each thread for itself
+        if (id.UsePerf) {
+            PerfCounters& pc = perfs[threadn];
+            pc.Open(num_run_phases);
+            if (pc.Active()) clk.Attach(&pc);
+        }
+        // timeline, if requested; at level 1, the work on subpopulations
+        // is merged into one event per generation
+        TraceBuffer& trc = traces[threadn];
+        if (!id.TraceName.empty()) {
+            std::uint32_t merge = 0;
+            if (id.TraceLevel < 2) {
+                for (RunPhase ph : {rp_setup, rp_learn, rp_stats, rp_repro}) {
+                    merge |= std::uint32_t(1) << ph;
+                }
+            }
+            trc.Open(id.TraceEvents, run_start, merge, num_run_phases);
+            clk.Attach(&trc);
+        }
+        clk.Start();
         // run through generations
-        for (int gen = 0; gen < numgen; ++gen) {
+        for (int gen = first_gen; gen < end_gen; ++gen) {
+            bool stat_gen = stat_tw && (gen + 1) % id.StatEvery == 0;
+            bool dump_gen = id.DumpEvery > 0 && gen < numgen - 1 &&
+                (gen + 1) % id.DumpEvery == 0;
+            bool snap_gen = snap_w && (gen + 1) % id.SnapEvery == 0;
+            bool use_cache = id.LCache && (gen > 0 || !id.cont_gen);
+            bool tree_gen = rec_tree && gen < numgen - 1 &&
+                (gen + 1) % id.TreeSimplify == 0;
+            // with structured migration, the threads only wait for each
+            // other in generations with work for all subpopulations; the
+            // live status and the CkptMinutes clock are only handled in
+            // such generations, so they do not add barriers
+            bool sync = !structured || gen == end_gen - 1 || stat_gen ||
+                dump_gen || snap_gen || tree_gen ||
+                (id.CkptEvery > 0 && (gen + 1) % id.CkptEvery == 0);
+            MigPlan plan;
+            if (structured) {
+                std::seed_seq ss{mig_seed, static_cast<unsigned>(gen)};
+                rand_eng peng(ss);
+                plan = MakeMigPlan(stepping, id.MigRate, nsp, Ns, peng);
+            }
+            LiveSum& lsum = live_sums[threadn];
+            lsum = LiveSum();
+            trc.SetGen(gen + 1, (gen + 1) % id.TraceEvery == 0);
+            if (rec_tree && threadn == 0 && gen < numgen - 1) {
+                tseq.AddGeneration(gen + 1);
+            }
             // set up (thread-local) MetaPopState object
             MetaPopState<subpop_type> popl(NP2 - NP1, max_inds);
             for (int n = NP1; n < NP2; ++n) {
@@ -179,6 +932,7 @@ void Evo::Run()
                 subpop_type& spl = popl[n - NP1];
                 // set subpopulation number of local
                 spl.st.spn = n;
+                trc.SetSubPop(n);
                 for (int i = 0; i < spg.size(); ++i) {
                     spl.Add(spg[i]);
                 }
@@ -190,6 +944,7 @@ void Evo::Run()
                         ph.p = ph.q + ph.d;
                     }
                 }
+                clk.Lap(rp_setup);
                 // set up interaction groups, interact and get data
                 for (int k = 0; k < ngsp; ++k) {
                     vph_type phen(g);
@@ -197,78 +952,554 @@ void Evo::Run()
                         int i = k*g + j;
                         phen[j] = spl[i].phenotype;
                     }
-                    acg_type acg(g, T, B0, B1, B2, K1, K11, K12, sigma,
-                                 alphaw, alphatheta, lambdatheta, phen);
+                    // use a cached outcome, if there is one (not when
+                    // learning continues from a previous run)
+                    lcache_type::Probe pr;
+                    if (use_cache) {
+                        pr = lcaches[threadn].Find(phen, gen, eng);
+                        if (pr.hit) {
+                            lcache_type::Apply(pr, phen);
+                            for (int j = 0; j < g; ++j) {
+                                spl[k*g + j].phenotype = phen[j];
+                            }
+                            continue;
+                        }
+                    }
+                    acg_model acg(g, T, pay, sigma, alphaw, alphatheta,
+                                  lambdatheta, phen);
                     acg.Interact(eng);
                     const vph_type& memb = acg.Get_memb();
+                    if (use_cache) lcaches[threadn].Add(pr, memb, gen, eng);
                     for (int j = 0; j < g; ++j) {
                         int i = k*g + j;
                         spl[i].phenotype = memb[j];
                     }
                 }
+                clk.Lap(rp_learn);
+                if (live.Active()) {
+                    for (int i = 0; i < spl.size(); ++i) {
+                        lsum.d += spl[i].phenotype.d;
+                        lsum.theta += spl[i].phenotype.theta;
+                    }
+                    lsum.n += spl.size();
+                    clk.Lap(rp_stats);
+                }
+                if (stat_gen) {
+                    TraitStats& st = learn_st[n];
+                    st.clear();
+                    for (int i = 0; i < spl.size(); ++i) {
+                        st.Add(spl[i].phenotype);
+                    }
+                    clk.Lap(rp_stats);
+                }
 // #pragma omp critical
                 // this section is not really critical, because each thread
                 // writes to different subpopulations next_pop[n] (or pop[n])
+                if (dump_gen || snap_gen) {
+                    // make individuals after learning available for the
+                    // dump or snapshot (pop[n] is overwritten by migration
+                    // anyway)
+                    for (int i = 0; i < spg.size(); ++i) {
+                        spg[i] = spl[i];
+                    }
+                    clk.Lap(rp_io);
+                }
                 if (gen < numgen - 1) {
                     // if not final generation, get offspring from this
                     // subpopulation and put into next_pop
                     subpop_type& next_spg = next_pop[n];
                     next_spg.clear();
-                    next_spg.ind = SelectReproduce(spl, mr);
+                    std::uint64_t first_gid =
+                        static_cast<std::uint64_t>(gen + 1)*N + n*Ns;
+                    if (rec_tree) {
+                        next_spg.ind = SelectReproduce(spl, mr, &tseq,
+                            threadn, &pop_gids[n], first_gid);
+                        for (std::size_t j = 0; j < Ns; ++j) {
+                            next_gids[n][j] = first_gid + j;
+                        }
+                    } else {
+                        next_spg.ind = SelectReproduce(spl, mr);
+                    }
+                    clk.Lap(rp_repro);
+                    if (stat_gen) {
+                        TraitStats& st = repro_st[n];
+                        st.clear();
+                        for (int i = 0; i < next_spg.size(); ++i) {
+                            st.Add(next_spg[i].phenotype);
+                        }
+                        clk.Lap(rp_stats);
+                    }
+                    if (structured) {
+                        // send the last offspring as migrants (offspring
+                        // are in random order)
+                        std::size_t K = plan.shifts.size();
+                        for (std::size_t r = 0; r < K; ++r) {
+                            std::size_t dest = (n + plan.shifts[r]) % nsp;
+                            std::size_t pos = Ns - K + r;
+                            mig.Send(threadn, owner(dest),
+                                     {gen, dest, pos, next_spg[pos]});
+                        }
+                        clk.Lap(rp_migrate);
+                    }
                 } else {
                     for (int i = 0; i < spg.size(); ++i) {
                         spg[i] = spl[i];
                     }
                     // set subpopulation number
                     spg.st.spn = n;
+                    clk.Lap(rp_setup);
+                }
+            }
+            trc.SetSubPop(-1);
+            load_bal.SetWork(threadn, clk.GenElapsed());
+            if (structured && gen < numgen - 1) {
+                // wait for the migrants to this thread's subpopulations,
+                // and shuffle each subpopulation into new groups
+                std::size_t expect = plan.shifts.size()*(NP2 - NP1);
+                std::size_t got = 0;
+                auto place = [this](const auto& msg) {
+                    next_pop[msg.spn][msg.pos] = msg.ind;
+                };
+                while ((got += mig.Receive(threadn, gen, place)) < expect) {
+                    std::this_thread::yield();
+                }
+                for (int n = NP1; n < NP2; ++n) {
+                    subpop_type& sp = next_pop[n];
+                    if (rec_tree) {
+                        // migrant r came from subpopulation n - s_r, where
+                        // it was offspring Ns - K + r; the gids are shuffled
+                        // with a copy of the engine, so that they follow
+                        // the individuals
+                        std::size_t K = plan.shifts.size();
+                        std::uint64_t base = static_cast<std::uint64_t>(
+                            gen + 1)*N;
+                        for (std::size_t r = 0; r < K; ++r) {
+                            std::size_t src = (n + nsp - plan.shifts[r])%nsp;
+                            std::size_t pos = Ns - K + r;
+                            next_gids[n][pos] = base + src*Ns + pos;
+                        }
+                        rand_eng geng = eng;
+                        std::shuffle(next_gids[n].begin(),
+                                     next_gids[n].end(), geng);
+                    }
+                    std::shuffle(sp.ind.begin(), sp.ind.end(), eng);
+                    for (int i = 0; i < Ns; ++i) {
+                        sp[i].spn = n;
+                        sp[i].phenotype.gnum = i/g + 1;
+                        sp[i].phenotype.inum = i%g + 1;
+                    }
+                    if (!sync) {
+                        pop[n].swap(next_pop[n]);
+                        if (rec_tree) pop_gids[n].swap(next_gids[n]);
+                    }
+                }
+                clk.Lap(rp_migrate);
+                if (!sync) {
+                    if (threadn == 0) ++PrBar;
+                    clk.EndGen();
+                    continue;
                 }
             }
 #pragma omp barrier
+            clk.Lap(rp_wait_work);
+            double serial_start = clk.GenElapsed();
+            if (threadn == 0 && stat_gen) {
+                WriteStats(*stat_tw, gen + 1, "learn", learn_st,
+                           num_stat_traits);
+                if (gen < numgen - 1) {
+                    // offspring have not learned, so only report the
+                    // genetically determined traits
+                    WriteStats(*stat_tw, gen + 1, "repro", repro_st, 3);
+                }
+            }
+            if (threadn == 0 && dump_gen) {
+                WritePop(DumpFileName(id.OutName, gen + 1), gen + 1);
+            }
+            if (threadn == 0 && snap_gen) {
+                WriteSnap(*snap_w, gen + 1);
+            }
+            clk.Lap(rp_io);
             if (threadn == 0 && gen < numgen - 1) {
                 // if not final generation, transfer all individuals to random
-                // position in pop, for start of next generation; the code
-                // below copies a random individual from next_pop for each
-                // position in pop
-                i_type indx(N, 0);
-                for (std::size_t n = 0; n < N; ++n) {
-                    indx[n] = n;
-                }
-                // construct positions, 0 to N-1, of "random individuals"
-                std::shuffle(indx.begin(), indx.end(), eng);
-                std::size_t n = 0;
-                for (std::size_t spn = 0; spn < nsp; ++spn) {
-                    subpop_type& sp = pop[spn];
-                    for (int k = 0; k < ngsp; ++k) {
-                        int gnum = k + 1; // group number
-                        for (int j = 0; j < g; ++j) {
-                            int inum = j + 1;
-                            int i = k*g + j;
-                            // construct position in next_pop corresponding to
-                            // n for "random individual"
-                            i_pair n_i = spn_i(indx[n++]);
-                            sp[i] = next_pop[n_i.first][n_i.second];
-                            // update spn, gnum, inum for copied individual
-                            sp[i].spn = spn;
-                            sp[i].phenotype.gnum = gnum;
-                            sp[i].phenotype.inum = inum;
-                        }
+                // position in pop, for start of next generation (with
+                // structured migration, next_pop is the next generation)
+                if (structured) {
+                    for (std::size_t n = 0; n < nsp; ++n) {
+                        pop[n].swap(next_pop[n]);
                     }
+                    pop_gids.swap(next_gids);
+                } else if (rec_tree) {
+                    Migrate(next_pop, pop, eng, &next_gids, &pop_gids);
+                } else {
+                    Migrate(next_pop, pop, eng);
+                }
+                clk.Lap(rp_migrate);
+                if (tree_gen) {
+                    tseq.Simplify();
+                    clk.Lap(rp_repro);
                 }
                 // all set to start next generation
                 ++PrBar;
+                // save a checkpoint, if it is time for one; the other
+                // threads wait at the barrier below, so that the states of
+                // their engines do not change
+                if (ckpt_on) {
+                    auto now = std::chrono::steady_clock::now();
+                    double mins =
+                        std::chrono::duration<double>(now - last_ckpt).count()
+                        /60.0;
+                    if ((id.CkptEvery > 0 && (gen + 1) % id.CkptEvery == 0)
+                        || (id.CkptMinutes > 0.0 && mins >= id.CkptMinutes)) {
+                        // snapshots up to now are part of the checkpoint
+                        if (snap_w) snap_w->Commit();
+                        if (!WriteCheckpoint(gen + 1)) {
+                            std::cout << "\nFailed to write checkpoint "
+                                      << id.CkptName << '\n';
+                        }
+                        last_ckpt = now;
+                    }
+                    clk.Lap(rp_io);
+                }
             }
+            if (threadn == 0 && live.Active()) {
+                // the other threads wait at the barrier below, so their
+                // sums and clocks can be read
+                double gens = gen + 1 - start_gen;
+                double sum_d = 0.0;
+                double sum_theta = 0.0;
+                std::size_t n = 0;
+                for (int t = 0; t < num_thrds; ++t) {
+                    const LiveSum& ls = live_sums[t];
+                    sum_d += ls.d;
+                    sum_theta += ls.theta;
+                    n += ls.n;
+                    double learn_t = clocks[t].Total(rp_learn)
+                        + clocks[t].GenTime(rp_learn);
+                    live_info.thread_steps_per_s[t] = (learn_t > 0.0) ?
+                        static_cast<double>(ls.n)*T*gens/learn_t : 0.0;
+                }
+                live_info.gen = gen + 1;
+                live_info.elapsed = std::chrono::duration<double>(
+                    std::chrono::steady_clock::now() - run_start).count();
+                live_info.steps_per_s = (live_info.elapsed > 0.0) ?
+                    static_cast<double>(N)*T*gens/live_info.elapsed : 0.0;
+                live_info.mean_d = (n > 0) ? sum_d/n : 0.0;
+                live_info.mean_theta = (n > 0) ? sum_theta/n : 0.0;
+                live.Publish(live_info);
+                clk.Lap(rp_io);
+            }
+            if (threadn == 0) {
+                load_bal.AddGen(clk.GenElapsed() - serial_start);
+            }
+            // wait for thread 0 to finish with pop and the statistics,
+            // before starting the next generation
+#pragma omp barrier
+            clk.Lap(rp_wait_serial);
+            clk.EndGen();
         }
     }
+    double run_secs = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - run_start).count();
+    if (stat_tw && !stat_tw->Close()) {
+        std::cout << "Failed to write " << id.StatName << '\n';
+    }
+    if (snap_w && !snap_w->Close()) {
+        std::cout << "Failed to write " << id.SnapName << ": "
+                  << snap_w->Error() << '\n';
+    }
     PrBar.Final();
+    start_gen = end_gen;
+    if (live.Active()) {
+        live_info.done = end_gen == numgen;
+        live.Publish(live_info);
+        live.Stop();
+    }
+    if (id.UsePerf && !perfs.empty() && !perfs[0].Error().empty()) {
+        std::cout << "Note: performance counters not available ("
+                  << perfs[0].Error() << ")\n";
+    }
     timer.Stop();
     timer.Display();
-    pop.Write_to_File(id.OutName);
+    if (!lcaches.empty()) {
+        // use of the learning-outcome cache, and the mean difference
+        // between cached and simulated outcomes, with its standard error
+        LearnCacheStats lcs;
+        std::size_t keys = 0;
+        for (const auto& lc : lcaches) {
+            lcs.Merge(lc.Stats());
+            keys += lc.NumKeys();
+        }
+        double hit_rate = (lcs.groups > 0) ?
+            static_cast<double>(lcs.hits)/lcs.groups : 0.0;
+        std::cout << "Learning cache: " << lcs.hits << " hits of "
+                  << lcs.groups << " groups (" << 100.0*hit_rate
+                  << "%), " << lcs.audits << " audits, " << keys
+                  << " keys, " << lcs.flushes << " flushes\n";
+        auto bias = [](const char* name, const RunStat& rs) {
+            double se = (rs.n > 0) ? rs.SD()/std::sqrt(rs.n) : 0.0;
+            std::cout << "  bias of " << name << ": " << rs.mean
+                      << " (SE " << se << ")\n";
+        };
+        if (lcs.audits > 0) {
+            std::cout << "Cached minus simulated outcomes (audit):\n";
+            bias("theta", lcs.bias_theta);
+            bias("w", lcs.bias_w);
+            bias("payoff", lcs.bias_payoff);
+        }
+    }
+    if (end_gen == numgen) {
+        WritePop(id.OutName, numgen);
+        if (rec_tree) WriteTree(id.TreeName);
+        WriteMem();
+    }
+    if (!id.ProfName.empty()) {
+        ProfInfo info;
+        info.inp_name = id.InpName;
+        info.num_thrds = num_thrds;
+        info.nsp = nsp;
+        info.N = N;
+        info.T = T;
+        info.generations = end_gen - first_gen;
+        info.offspring = N*(end_gen - first_gen
+                            - (end_gen == numgen ? 1 : 0));
+        info.wall_seconds = run_secs;
+        if (!WriteProfReport(id.ProfName, info, clocks, load_bal, perfs)) {
+            std::cout << "Failed to write " << id.ProfName << '\n';
+        }
+    }
+    if (!id.TraceName.empty()) {
+        // names of phases, and of the merged work phases
+        std::vector<std::string> names(RunPhaseNames.begin(),
+                                       RunPhaseNames.end());
+        names.push_back("work");
+        if (!WriteTrace(id.TraceName, traces, names)) {
+            std::cout << "Failed to write " << id.TraceName << '\n';
+        }
+        std::size_t dropped = 0;
+        for (const TraceBuffer& tb : traces) dropped += tb.Dropped();
+        if (dropped > 0) {
+            std::cout << "Note: " << dropped << " early trace events were "
+                      << "overwritten (increase TraceEvents or TraceEvery)\n";
+        }
+    }
+}
+
+// write the genealogy, with the final population as samples
+void Evo::WriteTree(const std::string& filename)
+{
+    std::vector<std::uint64_t> gids;
+    std::vector<std::uint32_t> spns;
+    gids.reserve(N);
+    spns.reserve(N);
+    for (std::size_t n = 0; n < nsp; ++n) {
+        for (std::size_t i = 0; i < pop[n].size(); ++i) {
+            gids.push_back(pop_gids[n][i]);
+            spns.push_back(static_cast<std::uint32_t>(pop[n][i].spn));
+        }
+    }
+    std::size_t max_nodes = tseq.MaxNodes();
+    if (!tseq.Write(filename, gids, spns)) {
+        std::cout << "Failed to write " << filename << '\n';
+        return;
+    }
+    std::cout << "Genealogy: " << tseq.NumNodes() << " nodes, "
+              << tseq.NumEdges() << " edges (at most " << max_nodes
+              << " nodes recorded)\n";
+}
+
+// write pop to file, using the output columns, sampling and precision from
+// the input data (the sample depends on the generation)
+bool Evo::WritePop(const std::string& filename, int gen)
+{
+    PopOutSpec spec = out_spec;
+    spec.seed += gen;
+    return pop.Write_to_File(filename, spec);
+}
+
+// add a snapshot of all individuals in pop to the store
+void Evo::WriteSnap(SnapWriter& sw, int gen)
+{
+    std::vector<std::vector<double>> data;
+    pop.Columns(snap_spec, data);
+    sw.Add(gen, data);
+}
+
+// write a checkpoint, from which the run can continue with generation
+// next_gen; the meta data are text, with the generation, the states of the
+// random number engines and mutational increment distributions, and the
+// contents of the input file
+bool Evo::WriteCheckpoint(int next_gen)
+{
+    std::ostringstream meta;
+    meta << "EvoProg checkpoint\n";
+    meta << "next_gen " << next_gen << '\n';
+    meta << "num_thrds " << num_thrds << '\n';
+    meta << "rand_eng " << EngineName<rand_eng>() << '\n';
+    meta << "out_seed " << out_spec.seed << '\n';
+    meta << "mig_seed " << mig_seed << '\n';
+    for (std::size_t i = 0; i < num_thrds; ++i) {
+        meta << "eng " << i << ' ' << engs[i] << '\n';
+        meta << "mi " << i << ' ' << mrs[i].mi << '\n';
+    }
+    meta << "inp_file\n" << inp_text;
+    return WriteCkptFile(id.CkptName, meta.str(),
+        [this](std::FILE* fp) { return pop.Write_to_Bin(fp); });
+}
+
+bool Evo::ReadCheckpoint()
+{
+    CkptFile ckf(id.CkptName);
+    if (!ckf.OK()) {
+        std::cout << "Cannot resume from " << id.CkptName << ": "
+                  << ckf.Error() << '\n';
+        return false;
+    }
+    std::istringstream meta(ckf.Meta());
+    std::string key;
+    std::string key2;
+    meta >> key >> key2;
+    if (key != "EvoProg" || key2 != "checkpoint") {
+        std::cout << "Invalid checkpoint " << id.CkptName << '\n';
+        return false;
+    }
+    std::size_t ckpt_thrds = 0;
+    while (meta >> key && key != "inp_file") {
+        std::size_t i = 0;
+        if (key == "next_gen") {
+            meta >> start_gen;
+        } else if (key == "num_thrds") {
+            meta >> ckpt_thrds;
+            if (ckpt_thrds != num_thrds) {
+                std::cout << "Checkpoint was saved with " << ckpt_thrds
+                          << " threads, and can only be resumed with the"
+                          << " same number of threads\n";
+                return false;
+            }
+        } else if (key == "rand_eng") {
+            std::string name;
+            meta >> name;
+            if (name != EngineName<rand_eng>()) {
+                std::cout << "Checkpoint was saved with random engine "
+                          << name << ", but this program uses "
+                          << EngineName<rand_eng>() << '\n';
+                return false;
+            }
+        } else if (key == "out_seed") {
+            meta >> out_spec.seed;
+        } else if (key == "mig_seed") {
+            meta >> mig_seed;
+        } else if (key == "eng" && meta >> i && i < num_thrds) {
+            meta >> engs[i];
+        } else if (key == "mi" && meta >> i && i < num_thrds) {
+            meta >> mrs[i].mi;
+        } else {
+            break;
+        }
+    }
+    if (!meta || key != "inp_file" || ckpt_thrds != num_thrds) {
+        std::cout << "Invalid checkpoint " << id.CkptName << '\n';
+        return false;
+    }
+    meta.get(); // newline after inp_file
+    std::string ckpt_inp = meta.str().substr(meta.tellg());
+    if (ckpt_inp != inp_text) {
+        std::cout << "Note: the input file differs from the one saved in "
+                  << id.CkptName << '\n';
+    }
+    if (!pop.Read_from_Bin(ckf.Pop(), N)) {
+        std::cout << "Invalid population in " << id.CkptName << '\n';
+        return false;
+    }
+    for (std::size_t n = 0; n < nsp; ++n) {
+        pop[n].st.spn = n;
+        next_pop[n].st.spn = n;
+    }
+    std::cout << "Resuming from generation " << start_gen + 1 << '\n';
+    return true;
+}
+
+// write statistics for the first ntr traits (in the order of StatTrait) to
+// the per-generation table, per subpopulation (if requested) and for the
+// whole population (with SubPop given as -1)
+void Evo::WriteStats(TextWriter& tw, int gen, const char* phase,
+                     const std::vector<TraitStats>& st, std::size_t ntr)
+{
+    TraitStats tot;
+    for (const auto& sts : st) {
+        tot.Merge(sts);
+    }
+    std::size_t nrows = id.StatSubPops ? nsp + 1 : 1;
+    for (std::size_t r = 0; r < nrows; ++r) {
+        // global statistics first
+        const TraitStats& ts = (r == 0) ? tot : st[r - 1];
+        for (std::size_t t = 0; t < ntr; ++t) {
+            const RunStat& rs = ts.rs[t];
+            tw.Put(static_cast<double>(gen));
+            tw.Put('\t');
+            tw.Put(phase);
+            tw.Put('\t');
+            tw.Put((r == 0) ? -1.0 : static_cast<double>(r - 1));
+            tw.Put('\t');
+            tw.Put(StatTraitNames[t]);
+            tw.Put('\t');
+            tw.Put(static_cast<double>(rs.n));
+            tw.Put('\t');
+            tw.Put(rs.mean);
+            tw.Put('\t');
+            tw.Put(rs.SD());
+            for (double p : StatQuantiles) {
+                tw.Put('\t');
+                tw.Put(ts.qs[t].Quantile(p));
+            }
+            tw.Put('\n');
+        }
+    }
+}
+
+// copy a random individual from from_pop to each position in to_pop, so
+// that every individual in from_pop is copied once (the positions are a
+// random permutation of the individuals in the metapopulation)
+void Evo::Migrate(const metapop_type& from_pop, metapop_type& to_pop,
+                  rand_eng& eng, const std::vector<gid_vec_type>* from_gids,
+                  std::vector<gid_vec_type>* to_gids)
+{
+    i_type indx(N, 0);
+    for (std::size_t n = 0; n < N; ++n) {
+        indx[n] = n;
+    }
+    // construct positions, 0 to N-1, of "random individuals"
+    std::shuffle(indx.begin(), indx.end(), eng);
+    std::size_t n = 0;
+    for (std::size_t spn = 0; spn < nsp; ++spn) {
+        subpop_type& sp = to_pop[spn];
+        for (int k = 0; k < ngsp; ++k) {
+            int gnum = k + 1; // group number
+            for (int j = 0; j < g; ++j) {
+                int inum = j + 1;
+                int i = k*g + j;
+                // construct position in from_pop corresponding to n for
+                // "random individual"
+                i_pair n_i = spn_i(indx[n++]);
+                sp[i] = from_pop[n_i.first][n_i.second];
+                // update spn, gnum, inum for copied individual
+                sp[i].spn = spn;
+                sp[i].phenotype.gnum = gnum;
+                sp[i].phenotype.inum = inum;
+                if (to_gids) {
+                    (*to_gids)[spn][i] = (*from_gids)[n_i.first][n_i.second];
+                }
+            }
+        }
+    }
 }
 
 // return vector of Ns offspring from the subpopulation in sp, with individual
 // payoff being proportional to the probability of delivering a gamete, and
 // using mutation and recombination parameters from mr
-Evo::vi_type Evo::SelectReproduce(const subpop_type& sp, mut_rec_type& mr)
+Evo::vi_type Evo::SelectReproduce(const subpop_type& sp, mut_rec_type& mr,
+                                  TreeSeq* ts, std::size_t thrd,
+                                  const gid_vec_type* sp_gids,
+                                  std::uint64_t first_gid)
 {
     vi_type offspr;
     offspr.reserve(Ns);
@@ -291,8 +1522,19 @@ Evo::vi_type Evo::SelectReproduce(const subpop_type& sp, mut_rec_type& mr)
             std::size_t ipat = dscr(mr.eng);
             const ind_type& patind = sp[ipat];
             // append new individual to offspr
-            offspr.emplace_back(matind.GetGamete(mr),
-                                patind.GetGamete(mr), spn);
+            if (ts) {
+                // record which genomes of the parents the gametes are from
+                std::uint32_t mat_orig;
+                std::uint32_t pat_orig;
+                offspr.emplace_back(matind.GetGamete(mr, mat_orig),
+                                    patind.GetGamete(mr, pat_orig), spn);
+                std::uint64_t gid = first_gid + j;
+                ts->AddGamete(thrd, (*sp_gids)[imat], gid, 0, mat_orig);
+                ts->AddGamete(thrd, (*sp_gids)[ipat], gid, 1, pat_orig);
+            } else {
+                offspr.emplace_back(matind.GetGamete(mr),
+                                    patind.GetGamete(mr), spn);
+            }
         }
     }
     return offspr;
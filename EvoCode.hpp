@@ -10,6 +10,16 @@
 #include "Individual.hpp"
 #include "MetaPopState.hpp"
 #include "ACgroup.hpp"
+#include "PopStats.hpp"
+#include "TextWriter.hpp"
+#include "SnapStore.hpp"
+#include "RunProfile.hpp"
+#include "LiveStatus.hpp"
+#include "LearnCache.hpp"
+#include "Migration.hpp"
+#include "Genealogy.hpp"
+#include "MemReport.hpp"
+#include "InpFile.hpp"
 #include <vector>
 #include <string>
 #include <cmath>
@@ -60,14 +70,66 @@ public:
     LocVec max_val;             // Maximal allelic value at each locus
     LocVec min_val;             // Minimal allelic value at each locus
     LocVec rho;                 // Recombination rates
+    std::string MigModel;       // island or stepping (see Migration.hpp)
+    double MigRate;             // Migration rate (1: random shuffle)
+    std::string PayoffModel;    // Name of payoff model (see Payoff.hpp)
+    double Athr;                // Threshold of mean action for bonus
+    double Bthr;                // Bonus when threshold is reached
+    double Kexp;                // Exponent of nonlinear cost
+    std::string RunMode;        // evolve, or invasion (see EvoInvasion.cpp)
+    std::string InvName;        // File name for invasion-fitness results
+    std::size_t InvReps;        // Groups per estimate of selection gradient
+    double InvDelta;            // Difference in d for the gradient
+    std::size_t InvSteps;       // Steps of the canonical equation
+    double InvRate;             // Rate in the canonical equation
+    double InvTolSE;            // Standard errors of gradient to stop
+    bool LCache;                // Whether to use the learning-outcome cache
+    LearnCacheSpec LCacheSpec;  // Parameters of the cache
     LocVec all0;                // Starting allelic values (if not from file)
     std::string InName;         // File name for input of learning parameters
     std::string OutName;        // File name for output of learning parameters
+    int OutPrec;                // Significant digits in text output (0: exact)
+    std::string OutCols;        // Names of columns to output (empty: all)
+    double OutSample;           // Fraction of each subpopulation to output
+    std::size_t DumpEvery;      // Interval between population dumps (0: none)
+    std::string StatName;       // File name for per-generation statistics
+    bool StatSubPops;           // Whether statistics include subpopulations
+    std::size_t StatEvery;      // Interval in generations between statistics
+    std::string CkptName;       // File name for checkpoints
+    std::size_t CkptEvery;      // Interval in generations between checkpoints
+    double CkptMinutes;         // Interval in minutes between checkpoints
+    bool Resume;                // Whether to continue from the checkpoint
+    std::string SnapName;       // File name for snapshot store (empty: none)
+    std::size_t SnapEvery;      // Interval in generations between snapshots
+    std::string SnapCols;       // Names of columns in snapshots (empty: all)
+    std::string ProfName;       // File name for timing report (empty: none)
+    bool UsePerf;               // Whether to read hardware counters
+    unsigned Seed;              // Seed for random numbers (0: random seed)
+    std::string RandEngine;     // Random engine (must match the build)
+    std::string StatusName;     // File name for live status (empty: none)
+    int StatusPort;             // Loopback HTTP port for status (0: none)
+    std::string TraceName;      // File name for timeline trace (empty: none)
+    int TraceLevel;             // 1: work per generation, 2: per subpop
+    std::size_t TraceEvery;     // Interval in generations between traces
+    std::size_t TraceEvents;    // Capacity of trace buffer of each thread
+    std::string StoreName;      // File name for population store (empty:
+                                // population in memory)
+    double StoreMB;             // Memory budget with a store, in MB
+    std::string TreeName;       // File name for genealogy (empty: none)
+    std::size_t TreeSimplify;   // Interval in generations between
+                                // simplifications of the genealogy
+    double MemLimit;            // Memory limit of a run, in MB (0: the
+                                // physical memory)
 
     std::string InpName;  // Name of indata file
+    std::string InpText;  // Contents of indata file
     bool OK;              // Whether indata has been successfully read
 
     EvoInpData(const char* filename);
+    // Indata from the contents of an input file (name is used as InpName)
+    EvoInpData(const std::string& text, const std::string& name);
+private:
+    void ReadInp(const InpFile& inp);
 };
 
 
@@ -90,15 +152,86 @@ public:
     using i_type = std::vector<std::size_t>;
     using v_type = std::vector<double>;
     using i_pair = std::pair<std::size_t, std::size_t>;
-    using rand_eng = std::mt19937;
+    using gid_vec_type = std::vector<std::uint64_t>;
+    using rand_eng = RandEng;
     using rand_int = std::uniform_int_distribution<int>;
     using rand_uni = std::uniform_real_distribution<double>;
     using rand_norm = std::normal_distribution<double>;
     using rand_discr = std::discrete_distribution<int>;
     Evo(const EvoInpData& eid);
+    // the mutation records refer to the engines, so Evo cannot be copied
+    Evo(const Evo&) = delete;
+    Evo& operator=(const Evo&) = delete;
+    // Run the simulation, with the payoff model given in the input data
     void Run();
+    // Run at most num_gens generations of the simulation (with the
+    // population in memory) and return the number run, or -1 if the run
+    // cannot be done in steps; Run continues from there, and the output is
+    // written when the last generation has been run
+    int Step(int num_gens);
+    // Run num_steps more time steps of learning in the groups of the
+    // current population, without new qualities or reproduction, and return
+    // num_steps, or -1 as for Step
+    int Learn(int num_steps);
+    // Change parameter name (as in the input file) to value, for the
+    // following steps; returns false if the parameter cannot be changed or
+    // the value is not valid
+    bool SetParam(const std::string& name, const std::string& value);
+    // Write the current population, as the output in OutName
+    bool SavePop(const std::string& filename)
+    { return WritePop(filename, start_gen); }
+    // Generations run, and the population at the start of the next
+    // generation (after the last generation: the final population)
+    int Generation() const { return start_gen; }
+    int NumGenerations() const { return static_cast<int>(numgen); }
+    const metapop_type& Population() const { return pop; }
+    // Steps of a generation, also used by the benchmarks in Bench.cpp
+    // (with ts, the individuals of sp have the gids in sp_gids, offspring
+    // j gets gid first_gid + j, and their gametes are recorded in the
+    // genealogy, as thread thrd; with gids, Migrate moves them along with
+    // the individuals)
+    vi_type SelectReproduce(const subpop_type& sp, mut_rec_type& mr,
+                            TreeSeq* ts = nullptr, std::size_t thrd = 0,
+                            const gid_vec_type* sp_gids = nullptr,
+                            std::uint64_t first_gid = 0);
+    void Migrate(const metapop_type& from_pop, metapop_type& to_pop,
+                 rand_eng& eng,
+                 const std::vector<gid_vec_type>* from_gids = nullptr,
+                 std::vector<gid_vec_type>* to_gids = nullptr);
+    // Number of threads that a run with the input data would use
+    static std::size_t NumThreads(const EvoInpData& eid);
+    // Memory needed by the main data structures of a run with the input
+    // data and num_thrds threads, predicted before anything is allocated
+    static MemReport PredictMem(const EvoInpData& eid,
+                                std::size_t num_thrds);
+    // Write the predicted memory, and return false (with a message) if it
+    // exceeds MemLimit, or, if MemLimit is 0, the physical memory
+    static bool CheckMem(const EvoInpData& eid);
+    // Memory held by the data structures of this run (buffers that are
+    // only held during a generation are given as predicted)
+    MemReport HeldMem() const;
 private:
-    vi_type SelectReproduce(const subpop_type& sp, mut_rec_type& mr);
+    template<typename PayoffType>
+    void RunModel(int end_gen);
+    template<typename PayoffType>
+    void LearnModel(std::size_t num_steps);
+    bool StepsAvailable();
+    // invasion-fitness mode (in EvoInvasion.cpp)
+    void RunInvasion();
+    template<typename PayoffType>
+    void InvasionModel();
+    // run with the population in a disk-backed store (in EvoStore.cpp)
+    void RunStored();
+    template<typename PayoffType>
+    void StoredModel();
+    void WriteStats(TextWriter& tw, int gen, const char* phase,
+                    const std::vector<TraitStats>& st, std::size_t ntr);
+    bool WritePop(const std::string& filename, int gen);
+    void WriteMem() const;
+    void WriteSnap(SnapWriter& sw, int gen);
+    void WriteTree(const std::string& filename);
+    bool WriteCheckpoint(int next_gen);
+    bool ReadCheckpoint();
     i_pair spn_i(std::size_t n) { return i_pair(n / Ns, n % Ns); }
 
     EvoInpData id;
@@ -111,12 +244,7 @@ private:
     std::size_t N;
     std::size_t T;
     std::size_t numgen;
-    double B0;
-    double B1;
-    double B2;
-    double K1;
-    double K11;
-    double K12;
+    PayoffPars pay_pars;
     double sigma;
     double alphaw;
     double alphatheta;
@@ -125,9 +253,27 @@ private:
     v_type qv;
     std::size_t num_thrds;
     std::vector<unsigned> sds;
+    std::vector<rand_eng> engs;     // one random number engine per thread
+    std::vector<mut_rec_type> mrs;  // one mutation record per thread
+    unsigned mig_seed;              // seed for plans of migration
+    int start_gen;                  // next generation (> 0 if resumed)
+    std::string inp_text;           // contents of the input file
     bool popOK;
     metapop_type pop;
     metapop_type next_pop;
+    PopOutSpec out_spec;
+    PopOutSpec snap_spec;
+    std::vector<TraitStats> learn_st;   // per subpopulation, after learning
+    std::vector<TraitStats> repro_st;   // per subpopulation, for offspring
+    std::vector<PhaseClock> clocks;     // per thread, times of phases
+    LoadBalance load_bal;               // load balance between threads
+    std::vector<PerfCounters> perfs;    // per thread, hardware counters
+    std::vector<TraceBuffer> traces;    // per thread, timeline events
+    std::vector<LearnCache<phen_type>> lcaches; // per thread, outcome cache
+    TreeSeq tseq;                       // genealogy, if TreeName is given
+    std::vector<gid_vec_type> pop_gids;     // per subpopulation, gids of pop
+    std::vector<gid_vec_type> next_gids;    // and of next_pop (only with
+                                            // TreeName, see Genealogy.hpp)
 };
 
 #endif // EVOCODE_HPP
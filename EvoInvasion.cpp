@@ -0,0 +1,161 @@
+#include "EvoCode.hpp"
+#include "Utils.hpp"
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+
+// The EvoProg program runs actor-critic learning simulations
+// Copyright (C) 2019  Olof Leimar
+// See Readme.md for copyright notice
+
+// This file implements the invasion-fitness (adaptive dynamics) mode of Evo,
+// selected with RunMode = invasion. The population is taken to be
+// monomorphic, with all individuals like the first individual of the
+// starting population, except for the cognitive bias d. A mutant with bias
+// d_mut in a group of residents with bias d has expected payoff W(d_mut, d),
+// and since reproductive success is proportional to payoff, the selection
+// gradient is D(d) = (dW/d_mut)/W, evaluated at d_mut = d, where W is the
+// mean payoff in resident groups. The derivative is estimated as a central
+// difference, (W(d + h, d) - W(d - h, d))/(2h), from InvReps groups with one
+// mutant. For each group, the mutants with d + h and d - h, and a group of
+// only residents, are simulated with the same qualities and the same random
+// numbers for actions (common random numbers), which removes most of the
+// variation between groups from the difference. The same random numbers are
+// also used for different resident values of d, so the estimated gradient
+// changes smoothly with d.
+
+// Optionally, the canonical equation of adaptive dynamics, dd/dt = k*D(d),
+// is iterated (InvSteps steps, with k = InvRate), until the gradient is not
+// significantly different from zero (|D| < InvTolSE standard errors), which
+// locates an evolutionary singular point; the step is halved each time the
+// gradient changes sign. The results are written to InvName.
+
+namespace {
+
+struct InvGrad {
+// public:
+    double grad = 0.0;  // selection gradient
+    double se = 0.0;    // standard error of gradient
+    double wbar = 0.0;  // mean payoff of residents
+};
+
+} // namespace
+
+void Evo::RunInvasion()
+{
+    if (!popOK || nsp == 0 || pop[0].size() == 0) {
+        std::cout << "Starting population not valid \n";
+        return;
+    }
+    PayoffModels::Dispatch(id.PayoffModel, [this](auto tag) {
+        InvasionModel<typename decltype(tag)::type>();
+    });
+}
+
+template<typename PayoffType>
+void Evo::InvasionModel()
+{
+    using acg_model = ActCritGroup<phen_type, PayoffType>;
+    Timer timer(std::cout);
+    timer.Start();
+    const PayoffType pay(pay_pars);
+    // the resident phenotype, before learning
+    const phen_type res_ph = pop[0][0].phenotype;
+    const long reps = static_cast<long>(id.InvReps);
+    const double h = id.InvDelta;
+    const unsigned base_seed = sds[0];
+    // d is the sum of two allelic values
+    const double d_min = 2.0*id.min_val[2];
+    const double d_max = 2.0*id.max_val[2];
+
+    // selection gradient for resident bias d
+    auto gradient = [&](double d) {
+        std::vector<double> diff(reps);
+        std::vector<double> wres(reps);
+#pragma omp parallel for num_threads(num_thrds) schedule(dynamic, 16)
+        for (long r = 0; r < reps; ++r) {
+            // each group has its own random numbers, which are the same
+            // for the three simulations and for any d
+            std::seed_seq ss{base_seed, static_cast<unsigned>(r)};
+            rand_eng eng0(ss);
+            rand_int uri(0, Nqv - 1);
+            vph_type phen(g, res_ph);
+            for (phen_type& ph : phen) {
+                ph.d = d;
+                ph.Set_q(qv[uri(eng0)]);
+            }
+            // learning with member 0 as mutant with bias dm
+            auto learn = [&](double dm) {
+                vph_type ph_m = phen;
+                ph_m[0].d = dm;
+                ph_m[0].Set_q(ph_m[0].q);
+                rand_eng eng = eng0;
+                acg_model acg(g, T, pay, sigma, alphaw, alphatheta,
+                              lambdatheta, ph_m);
+                acg.Interact(eng);
+                return acg.Get_memb();
+            };
+            double w_plus = learn(d + h)[0].payoff;
+            double w_minus = learn(d - h)[0].payoff;
+            double w_res = 0.0;
+            for (const phen_type& ph : learn(d)) w_res += ph.payoff;
+            diff[r] = (w_plus - w_minus)/(2.0*h);
+            wres[r] = w_res/g;
+        }
+        // sum in a fixed order, so that results do not depend on threads
+        RunStat rs_diff;
+        RunStat rs_w;
+        for (long r = 0; r < reps; ++r) {
+            rs_diff.Add(diff[r]);
+            rs_w.Add(wres[r]);
+        }
+        InvGrad ig;
+        ig.wbar = rs_w.mean;
+        if (ig.wbar > 0.0) {
+            ig.grad = rs_diff.mean/ig.wbar;
+            ig.se = rs_diff.SD()/std::sqrt(static_cast<double>(reps))/ig.wbar;
+        }
+        return ig;
+    };
+
+    std::ofstream os(id.InvName.c_str());
+    if (!os) {
+        std::cout << "Cannot open " << id.InvName << '\n';
+        return;
+    }
+    os << "step\td\tgradient\tse\twbar\treps\n";
+    std::cout << "Invasion fitness, " << reps << " groups per estimate\n";
+    std::cout << "step\td\tgradient\tse\twbar\n";
+    double d = res_ph.d;
+    double rate = id.InvRate;
+    double prev_grad = 0.0;
+    for (std::size_t step = 0; ; ++step) {
+        InvGrad ig = gradient(d);
+        os << step << '\t' << d << '\t' << ig.grad << '\t' << ig.se << '\t'
+           << ig.wbar << '\t' << reps << '\n';
+        std::cout << step << '\t' << d << '\t' << ig.grad << '\t' << ig.se
+                  << '\t' << ig.wbar << '\n';
+        if (step >= id.InvSteps) break;
+        if (std::abs(ig.grad) <= id.InvTolSE*ig.se) {
+            std::cout << "Singular point at d = " << d
+                      << " (gradient within " << id.InvTolSE
+                      << " standard errors of zero)\n";
+            break;
+        }
+        // halve the step when the gradient changes sign (overshoot)
+        if (step > 0 && ig.grad*prev_grad < 0.0) rate *= 0.5;
+        prev_grad = ig.grad;
+        double d_next = d + rate*ig.grad;
+        if (d_next < d_min || d_next > d_max) {
+            d_next = std::min(std::max(d_next, d_min), d_max);
+            if (d_next == d) {
+                std::cout << "Boundary reached at d = " << d << '\n';
+                break;
+            }
+        }
+        d = d_next;
+    }
+    if (!os) std::cout << "Failed to write " << id.InvName << '\n';
+    timer.Stop();
+    timer.Display();
+}
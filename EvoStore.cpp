@@ -0,0 +1,302 @@
+#include "EvoCode.hpp"
+#include "PopStore.hpp"
+#include "Utils.hpp"
+#include <algorithm>
+#include <functional>
+#include <future>
+#include <memory>
+
+#ifdef PARA_RUN
+#include <omp.h>
+#endif
+
+// The EvoProg program runs actor-critic learning simulations
+// Copyright (C) 2019  Olof Leimar
+// See Readme.md for copyright notice
+
+// This file implements runs with the population in a disk-backed store,
+// selected with StoreName, for populations that do not fit in memory. The
+// current and next generations are kept in two PopStore files (StoreName.0
+// and StoreName.1, which are removed when opened), instead of pop and
+// next_pop. In each generation, blocks of subpopulations are read from the
+// current store, and the next block is read by another thread while the
+// threads of the run learn and reproduce in the current block. Offspring are
+// sent to random positions in the next store (PopScatter), and each
+// subpopulation is shuffled when it is read, which together is the same
+// random permutation of the metapopulation as in Evo::Migrate. The number
+// of subpopulations in a block is chosen so that the blocks (the block in
+// use, the block being read and the offspring) and the buffers for
+// scattering offspring fit within StoreMB megabytes.
+
+// The starting population is constructed from all0, per-generation
+// statistics are supported, and the final population is written as text to
+// OutName in parts. Population dumps, snapshots, checkpoints, the learning
+// cache, live status, timing reports, traces and the genealogy are not used
+// with a store.
+
+void Evo::RunStored()
+{
+    if (!popOK) {
+        std::cout << "Starting population not valid \n";
+        return;
+    }
+    PayoffModels::Dispatch(id.PayoffModel, [this](auto tag) {
+        StoredModel<typename decltype(tag)::type>();
+    });
+}
+
+template<typename PayoffType>
+void Evo::StoredModel()
+{
+    using acg_model = ActCritGroup<phen_type, PayoffType>;
+    const PayoffType pay(pay_pars);
+    Timer timer(std::cout);
+    timer.Start();
+    if (id.DumpEvery > 0 || !id.SnapName.empty() || id.CkptEvery > 0 ||
+        id.CkptMinutes > 0.0 || id.LCache || !id.StatusName.empty() ||
+        id.StatusPort > 0 || !id.ProfName.empty() || !id.TraceName.empty() ||
+        !id.TreeName.empty()) {
+        std::cout << "Note: dumps, snapshots, checkpoints, LCache, live "
+                  << "status, ProfName, TraceName and TreeName are not used "
+                  << "with StoreName\n";
+    }
+    // divide the memory budget: at most a quarter (and at most a whole
+    // subpopulation per slot) for scatter buffers, and the rest for three
+    // blocks of subpopulations
+    const std::size_t rec = sizeof(ind_type);
+    const double budget = id.StoreMB*1.0e6;
+    std::size_t buf_recs = static_cast<std::size_t>(budget/4.0/(nsp*rec));
+    buf_recs = std::min(std::max(buf_recs, std::size_t(1)), Ns);
+    const double scat_bytes = static_cast<double>(nsp)*buf_recs*rec;
+    const double sp_bytes = static_cast<double>(Ns)*rec;
+    std::size_t blk_sps = (budget > scat_bytes) ?
+        static_cast<std::size_t>((budget - scat_bytes)/(3.0*sp_bytes)) : 0;
+    if (blk_sps == 0) {
+        std::cout << "StoreMB = " << id.StoreMB << " is too small, at least "
+                  << (scat_bytes + 3.0*sp_bytes)/1.0e6 << " MB are needed\n";
+        return;
+    }
+    blk_sps = std::min(blk_sps, nsp);
+    const std::size_t num_blks = (nsp + blk_sps - 1)/blk_sps;
+    PopStore stores[2];
+    for (int s = 0; s < 2; ++s) {
+        std::string name = id.StoreName + "." + std::to_string(s);
+        if (!stores[s].Open(name, rec, nsp, Ns)) {
+            std::cout << "Population store: " << stores[s].Error() << '\n';
+            return;
+        }
+    }
+    std::cout << "Population store: " << N << " individuals, "
+              << 2.0*stores[0].FileBytes()/1.0e6 << " MB on disk, blocks of "
+              << blk_sps << " subpopulations, "
+              << (scat_bytes + 3.0*blk_sps*sp_bytes)/1.0e6
+              << " MB in memory\n";
+    // construct all individuals as essentially the same
+    {
+        gam_type gam(id.all0); // starting gamete
+        ind_type ind(gam, 0);
+        std::vector<ind_type> spv(Ns, ind);
+        for (std::size_t n = 0; n < nsp; ++n) {
+            for (std::size_t i = 0; i < Ns; ++i) {
+                spv[i].spn = n;
+                spv[i].phenotype.gnum = i/g + 1;
+                spv[i].phenotype.inum = i%g + 1;
+            }
+            if (!stores[0].Write(n, 0, Ns, spv.data())) {
+                std::cout << "Population store: " << stores[0].Error()
+                          << '\n';
+                return;
+            }
+        }
+    }
+    // per-generation statistics, if requested
+    std::unique_ptr<TextWriter> stat_tw;
+    if (!id.StatName.empty()) {
+        stat_tw.reset(new TextWriter(id.StatName, 6));
+        if (!*stat_tw) {
+            std::cout << "Cannot open " << id.StatName
+                      << ", no statistics will be saved\n";
+            stat_tw.reset();
+        } else {
+            stat_tw->Put(StatColHeads());
+            stat_tw->Put('\n');
+        }
+    }
+    PopScatter<ind_type> scat(nsp, Ns, buf_recs);
+    // the block in use and the block being read
+    metapop_type blk(blk_sps, Ns);
+    metapop_type nxt(blk_sps, Ns);
+    std::vector<vi_type> offspr(blk_sps);
+    int cur = 0;
+    bool ok = true;
+    ProgressBar PrBar(std::cout, numgen);
+    for (int gen = 0; gen < numgen && ok; ++gen) {
+        bool last = gen == numgen - 1;
+        bool stat_gen = stat_tw && (gen + 1) % id.StatEvery == 0;
+        // individuals were scattered, except in the starting population
+        bool scattered = gen > 0;
+        PopStore& from = stores[cur];
+        if (!last) scat.Reset(&stores[1 - cur]);
+        std::unique_ptr<TextWriter> out_tw;
+        std::mt19937 out_eng(out_spec.seed + numgen);
+        std::vector<std::size_t> out_cols = out_spec.cols;
+        if (last) {
+            // the output, written in parts as for WritePop
+            out_tw.reset(new TextWriter(id.OutName, out_spec.prec));
+            if (!*out_tw) {
+                std::cout << "Cannot open " << id.OutName
+                          << ", cannot save data \n";
+                out_tw.reset();
+            } else {
+                std::vector<std::string> heads =
+                    SplitColHeads(ind_type::ColHeads());
+                if (out_cols.empty()) {
+                    for (std::size_t c = 0; c < heads.size(); ++c) {
+                        out_cols.push_back(c);
+                    }
+                }
+                for (std::size_t c = 0; c < out_cols.size(); ++c) {
+                    if (c > 0) out_tw->Put('\t');
+                    out_tw->Put(heads[out_cols[c]]);
+                }
+                out_tw->Put('\n');
+            }
+        }
+        // read block bk into b (unused subpopulations of b are empty)
+        auto read_blk = [this, &from, blk_sps](metapop_type& b,
+                                               std::size_t bk) {
+            for (std::size_t j = 0; j < blk_sps; ++j) {
+                std::size_t n = bk*blk_sps + j;
+                subpop_type& sp = b[j];
+                if (n >= nsp) {
+                    sp.clear();
+                    continue;
+                }
+                sp.ind.resize(Ns);
+                sp.st.spn = n;
+                if (!from.Read(n, 0, Ns, sp.ind.data())) return false;
+            }
+            return true;
+        };
+        std::future<bool> fut = std::async(std::launch::async, read_blk,
+                                           std::ref(nxt), 0);
+        for (std::size_t bk = 0; bk < num_blks; ++bk) {
+            if (!fut.get()) {
+                std::cout << "\nPopulation store: " << from.Error() << '\n';
+                ok = false;
+                break;
+            }
+            blk.swap(nxt);
+            if (bk + 1 < num_blks) {
+                fut = std::async(std::launch::async, read_blk,
+                                 std::ref(nxt), bk + 1);
+            }
+            const long nb = static_cast<long>(
+                std::min(blk_sps, nsp - bk*blk_sps));
+#pragma omp parallel for num_threads(num_thrds) schedule(static)
+            for (long j = 0; j < nb; ++j) {
+#ifdef PARA_RUN
+                int threadn = omp_get_thread_num();
+#else
+                int threadn = 0;
+#endif
+                rand_eng& eng = engs[threadn];
+                mut_rec_type& mr = mrs[threadn];
+                rand_int uri(0, Nqv - 1);
+                subpop_type& spl = blk[j];
+                std::size_t n = spl.st.spn;
+                if (scattered) {
+                    // complete the random permutation of migration
+                    std::shuffle(spl.ind.begin(), spl.ind.end(), eng);
+                }
+                for (std::size_t i = 0; i < Ns; ++i) {
+                    ind_type& indi = spl[i];
+                    indi.spn = n;
+                    indi.phenotype.gnum = i/g + 1;
+                    indi.phenotype.inum = i%g + 1;
+                    // assign (random) quality values
+                    phen_type& ph = indi.phenotype;
+                    ph.q = qv[uri(eng)];
+                    ph.p = ph.q + ph.d;
+                }
+                // set up interaction groups, interact and get data
+                for (int k = 0; k < ngsp; ++k) {
+                    vph_type phen(g);
+                    for (int jj = 0; jj < g; ++jj) {
+                        phen[jj] = spl[k*g + jj].phenotype;
+                    }
+                    acg_model acg(g, T, pay, sigma, alphaw, alphatheta,
+                                  lambdatheta, phen);
+                    acg.Interact(eng);
+                    const vph_type& memb = acg.Get_memb();
+                    for (int jj = 0; jj < g; ++jj) {
+                        spl[k*g + jj].phenotype = memb[jj];
+                    }
+                }
+                if (stat_gen) {
+                    TraitStats& st = learn_st[n];
+                    st.clear();
+                    for (int i = 0; i < spl.size(); ++i) {
+                        st.Add(spl[i].phenotype);
+                    }
+                }
+                if (!last) {
+                    offspr[j] = SelectReproduce(spl, mr);
+                    if (stat_gen) {
+                        TraitStats& st = repro_st[n];
+                        st.clear();
+                        for (const ind_type& indi : offspr[j]) {
+                            st.Add(indi.phenotype);
+                        }
+                    }
+                }
+            }
+            if (!last) {
+                // send the offspring to the next store, in a fixed order
+                for (long j = 0; j < nb && ok; ++j) {
+                    for (const ind_type& indi : offspr[j]) {
+                        if (!scat.Add(indi, engs[0])) {
+                            ok = false;
+                            break;
+                        }
+                    }
+                }
+            } else if (out_tw) {
+                blk.Put_Rows(*out_tw, out_cols, out_spec, out_eng);
+            }
+            if (!ok) {
+                std::cout << "\nPopulation store: "
+                          << stores[1 - cur].Error() << '\n';
+                break;
+            }
+        }
+        if (!ok) break;
+        if (stat_gen) {
+            WriteStats(*stat_tw, gen + 1, "learn", learn_st, num_stat_traits);
+            if (!last) WriteStats(*stat_tw, gen + 1, "repro", repro_st, 3);
+        }
+        if (!last) {
+            if (!scat.Flush()) {
+                std::cout << "\nPopulation store: "
+                          << stores[1 - cur].Error() << '\n';
+                ok = false;
+                break;
+            }
+            cur = 1 - cur;
+            ++PrBar;
+        } else if (out_tw && !out_tw->Close()) {
+            std::cout << "Failed to write " << id.OutName << '\n';
+        }
+    }
+    if (stat_tw && !stat_tw->Close()) {
+        std::cout << "Failed to write " << id.StatName << '\n';
+    }
+    PrBar.Final();
+    timer.Stop();
+    timer.Display();
+    double gb_read = (stores[0].BytesRead() + stores[1].BytesRead())/1.0e9;
+    double gb_written =
+        (stores[0].BytesWritten() + stores[1].BytesWritten())/1.0e9;
+    std::cout << "Population store: " << gb_read << " GB read, "
+              << gb_written << " GB written\n";
+}
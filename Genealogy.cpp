@@ -0,0 +1,153 @@
+#include "Genealogy.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+// The EvoProg program runs actor-critic learning simulations
+// Copyright (C) 2019  Olof Leimar
+// See Readme.md for copyright notice
+
+//*************************** Class TreeSeq ******************************
+
+void TreeSeq::Start(std::size_t num_loci, std::size_t num_inds, int time,
+                    std::uint64_t first_gid, std::size_t num_thrds)
+{
+    nl = static_cast<std::uint32_t>(num_loci);
+    ni = num_inds;
+    node_base = 0;
+    gid_base = first_gid;
+    next_gid = first_gid + ni;
+    node_time.assign(2*ni, time);
+    edges.clear();
+    bufs.assign(num_thrds, EdgeBuf());
+    max_nodes = node_time.size();
+}
+
+void TreeSeq::AddGeneration(int time)
+{
+    node_time.resize(node_time.size() + 2*ni, time);
+    next_gid += ni;
+    max_nodes = std::max(max_nodes, node_time.size());
+}
+
+std::size_t TreeSeq::NumEdges() const
+{
+    std::size_t ne = edges.size();
+    for (const EdgeBuf& eb : bufs) ne += eb.edges.size();
+    return ne;
+}
+
+void TreeSeq::Simplify()
+{
+    const std::size_t n = node_time.size();
+    const std::size_t first_sample = n - 2*ni;
+    // parent of each node at each locus (-1: none)
+    std::vector<std::int64_t> par(nl*n, -1);
+    auto set_par = [&par, n](const TsEdge& e) {
+        for (std::uint32_t l = e.left; l < e.right; ++l) {
+            par[l*n + e.child] = e.parent;
+        }
+    };
+    for (const TsEdge& e : edges) set_par(e);
+    for (EdgeBuf& eb : bufs) {
+        for (const TsEdge& e : eb.edges) set_par(e);
+        eb.edges.clear();
+    }
+    // number of children at each locus that are ancestors of samples (or
+    // samples), found from the latest nodes backwards, since a parent is
+    // always added before its children
+    std::vector<std::uint32_t> cnt(nl*n, 0);
+    auto reached = [&cnt, n, first_sample](std::uint32_t l, std::size_t v) {
+        return v >= first_sample || cnt[l*n + v] > 0;
+    };
+    std::vector<char> keep(n, 0);
+    for (std::size_t v = n; v-- > 0; ) {
+        if (v >= first_sample) keep[v] = 1;
+        for (std::uint32_t l = 0; l < nl; ++l) {
+            if (cnt[l*n + v] >= 2) keep[v] = 1;
+            if (reached(l, v) && par[l*n + v] >= 0) ++cnt[l*n + par[l*n + v]];
+        }
+    }
+    // replace parents by their nearest kept ancestors, from the earliest
+    // nodes forwards, and renumber the kept nodes in the same order
+    std::vector<std::int64_t> new_id(n, -1);
+    std::vector<std::int32_t> new_time;
+    for (std::size_t v = 0; v < n; ++v) {
+        for (std::uint32_t l = 0; l < nl; ++l) {
+            std::int64_t& p = par[l*n + v];
+            if (p >= 0 && !keep[p]) p = par[l*n + p];
+        }
+        if (keep[v]) {
+            new_id[v] = static_cast<std::int64_t>(new_time.size());
+            new_time.push_back(node_time[v]);
+        }
+    }
+    // edges of the kept nodes, with runs of loci with the same parent
+    // joined
+    edges.clear();
+    for (std::size_t v = 0; v < n; ++v) {
+        if (!keep[v]) continue;
+        std::int64_t child = new_id[v];
+        for (std::uint32_t l = 0; l < nl; ++l) {
+            std::int64_t p = par[l*n + v];
+            if (p < 0 || !reached(l, v)) continue;
+            std::int64_t parent = new_id[p];
+            if (!edges.empty() && edges.back().child == child &&
+                edges.back().parent == parent && edges.back().right == l) {
+                ++edges.back().right;
+            } else {
+                edges.push_back({parent, child, l, l + 1});
+            }
+        }
+    }
+    node_time.swap(new_time);
+    // the samples are the last nodes, in the order of their gids
+    node_base = static_cast<std::int64_t>(node_time.size() - 2*ni);
+    gid_base = next_gid - ni;
+}
+
+namespace {
+
+bool WriteBytes(std::FILE* fp, const void* p, std::size_t nbytes)
+{
+    return nbytes == 0 || std::fwrite(p, 1, nbytes, fp) == nbytes;
+}
+
+} // namespace
+
+bool TreeSeq::Write(const std::string& filename,
+                    const std::vector<std::uint64_t>& gids,
+                    const std::vector<std::uint32_t>& spns)
+{
+    Simplify();
+    std::FILE* fp = std::fopen(filename.c_str(), "wb");
+    if (!fp) return false;
+    const std::size_t first_sample = node_time.size() - 2*ni;
+    char magic[8];
+    std::memcpy(magic, "PGGTSEQ", 8);
+    std::uint32_t head32[2] = {1, nl};
+    std::uint64_t head64[4] = {node_time.size(), edges.size(), gids.size(),
+                               0};
+    bool ok = WriteBytes(fp, magic, sizeof(magic)) &&
+        WriteBytes(fp, head32, sizeof(head32)) &&
+        WriteBytes(fp, head64, sizeof(head64));
+    for (std::size_t v = 0; v < node_time.size() && ok; ++v) {
+        std::int32_t rec[2] = {node_time[v], v >= first_sample ? 1 : 0};
+        ok = WriteBytes(fp, rec, sizeof(rec));
+    }
+    for (const TsEdge& e : edges) {
+        if (!ok) break;
+        ok = WriteBytes(fp, &e.parent, 8) &&
+            WriteBytes(fp, &e.child, 8) &&
+            WriteBytes(fp, &e.left, 4) &&
+            WriteBytes(fp, &e.right, 4);
+    }
+    for (std::size_t i = 0; i < gids.size() && ok; ++i) {
+        std::int64_t node = Node(gids[i], 0);
+        std::uint32_t rec[2] = {spns[i], 0};
+        ok = WriteBytes(fp, &node, sizeof(node)) &&
+            WriteBytes(fp, rec, sizeof(rec));
+    }
+    if (std::fclose(fp) != 0) ok = false;
+    return ok;
+}
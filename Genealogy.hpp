@@ -0,0 +1,115 @@
+#ifndef GENEALOGY_HPP
+#define GENEALOGY_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// The EvoProg program runs actor-critic learning simulations
+// Copyright (C) 2019  Olof Leimar
+// See Readme.md for copyright notice
+
+//*************************** Class TreeSeq ******************************
+
+// The genealogy of a run, recorded as a tree sequence, when TreeName is
+// given. Each genome (the maternal and paternal gamete of an individual) is
+// a node, with the generation as its time, and an edge says that the loci
+// left to right - 1 of the child node were copied from the parent node (a
+// genome of one of the parents of the individual). Individuals are
+// identified by gid, which runs over 0 to N - 1 in the first generation, N
+// to 2N - 1 in the second, and so on, so that the nodes of a generation are
+// added together (AddGeneration) and the node of a genome can be computed
+// from the gid. The gids are not part of the individuals, but are kept by
+// Evo in vectors beside the subpopulations, which only exist when the
+// genealogy is recorded. Threads record the edges of their offspring in
+// their own buffers (AddGamete), without locking.
+
+// Simplify removes nodes and edges that do not contribute to the genomes of
+// the latest generation (the samples): for each locus, only the ancestors
+// of the samples are kept, and of these, only the nodes where lineages of
+// the samples merge (the nodes with two or more children at some locus),
+// with edges going directly to the nearest such ancestor. After
+// simplification the tables only grow with the coalescences of lineages, so
+// memory stays bounded in a long run, if Simplify is called regularly.
+
+// The file written by Write has the following binary format, with
+// integers in the byte order of the machine (little-endian on x86):
+//   header (48 bytes): char[8] "PGGTSEQ\0", uint32 version (1),
+//     uint32 number of loci, uint64 number of nodes, uint64 number of
+//     edges, uint64 number of individuals, uint64 reserved (0)
+//   nodes (8 bytes each): int32 time (generation), uint32 flags (1 for
+//     samples, the genomes of the final population)
+//   edges (24 bytes each): int64 parent, int64 child, uint32 left,
+//     uint32 right (the loci left to right - 1)
+//   individuals (16 bytes each), in the order of the final population:
+//     int64 node of the maternal genome (the paternal genome is the next
+//     node), uint32 subpopulation, uint32 reserved (0)
+// Edges are sorted by child, and a parent always has an earlier time than
+// its child.
+
+struct TsEdge {
+// public:
+    std::int64_t parent;
+    std::int64_t child;
+    std::uint32_t left;
+    std::uint32_t right;
+};
+
+class TreeSeq {
+public:
+    // Start with the num_inds founders, with gids first_gid and on, at
+    // generation time, using num_thrds buffers for edges
+    void Start(std::size_t num_loci, std::size_t num_inds, int time,
+               std::uint64_t first_gid, std::size_t num_thrds);
+    // Node of genome k (0: maternal, 1: paternal) of individual gid
+    std::int64_t Node(std::uint64_t gid, int k) const
+    { return node_base + 2*static_cast<std::int64_t>(gid - gid_base) + k; }
+    // Record that genome k of individual child_gid is a gamete of
+    // individual parent_gid, with bit l of origin set if locus l comes from
+    // the paternal genome of the parent (thread thrd)
+    void AddGamete(std::size_t thrd, std::uint64_t parent_gid,
+                   std::uint64_t child_gid, int k, std::uint32_t origin)
+    {
+        std::vector<TsEdge>& eb = bufs[thrd].edges;
+        std::int64_t child = Node(child_gid, k);
+        std::uint32_t left = 0;
+        for (std::uint32_t l = 1; l <= nl; ++l) {
+            std::uint32_t src = (origin >> left) & 1;
+            if (l == nl || ((origin >> l) & 1) != src) {
+                eb.push_back({Node(parent_gid, src), child, left, l});
+                left = l;
+            }
+        }
+    }
+    // Add the nodes of the next generation, at generation time (when no
+    // thread is simplifying)
+    void AddGeneration(int time);
+    // Remove what does not contribute to the latest generation (when no
+    // thread is recording)
+    void Simplify();
+    // Write the tables, with the latest generation in the order of gids
+    // (the gid and subpopulation of each individual)
+    bool Write(const std::string& filename,
+               const std::vector<std::uint64_t>& gids,
+               const std::vector<std::uint32_t>& spns);
+    bool Started() const { return !node_time.empty(); }
+    std::size_t NumNodes() const { return node_time.size(); }
+    std::size_t NumEdges() const;
+    std::size_t MaxNodes() const { return max_nodes; }
+private:
+    struct alignas(64) EdgeBuf {
+    // public:
+        std::vector<TsEdge> edges;
+    };
+    std::uint32_t nl = 0;               // number of loci
+    std::size_t ni = 0;                 // individuals per generation
+    std::int64_t node_base = 0;         // node of first genome of gid_base
+    std::uint64_t gid_base = 0;         // first gid of a recorded generation
+    std::uint64_t next_gid = 0;         // first gid of the next generation
+    std::vector<std::int32_t> node_time;
+    std::vector<TsEdge> edges;          // edges that have been simplified
+    std::vector<EdgeBuf> bufs;          // per thread, edges since then
+    std::size_t max_nodes = 0;
+};
+
+#endif // GENEALOGY_HPP
@@ -1,8 +1,10 @@
 #ifndef GENOTYPE_HPP
 #define GENOTYPE_HPP
 
+#include "RandEng.hpp"
 #include <random>
 #include <cmath>
+#include <cstdint>
 #include <array>
 #include <string>
 #include <ostream>
@@ -20,39 +22,66 @@
 // increments with a uniform (rectangular) distribution. Standardized means
 // that the increment has mean zero and standard deviation one.
 
-template<typename RandEng = std::mt19937>
+template<typename Eng = RandEng>
 struct MutIncrUni {
 // public:
-    using rand_eng = RandEng;
+    using rand_eng = Eng;
     using rand_uni = std::uniform_real_distribution<double>;
     rand_uni uni{-std::sqrt(3.0), std::sqrt(3.0)};
     // from minus to plus square root of 3 to get variance one
     double StdIncr(rand_eng& eng) { return uni(eng); }
 };
 
+// Output and input of the state (used for checkpoints)
+template<typename Eng>
+std::ostream& operator<<(std::ostream& ostr, const MutIncrUni<Eng>& mi)
+{
+    return ostr << mi.uni;
+}
+
+template<typename Eng>
+std::istream& operator>>(std::istream& istr, MutIncrUni<Eng>& mi)
+{
+    return istr >> mi.uni;
+}
+
 
 //*********************** Struct MutIncrNorm *********************************
 
 // Same as previous but with normally distributed increments
 
-template<typename RandEng = std::mt19937>
+template<typename Eng = RandEng>
 struct MutIncrNorm {
 // public:
-    using rand_eng = RandEng;
+    using rand_eng = Eng;
     using rand_norm = std::normal_distribution<double>;
     rand_norm nrm{0.0, 1.0};
     double StdIncr(rand_eng& eng) { return nrm(eng); }
 };
 
+// Output and input of the state (a normal distribution can hold a saved
+// value, so the state is needed to continue a run exactly)
+template<typename Eng>
+std::ostream& operator<<(std::ostream& ostr, const MutIncrNorm<Eng>& mi)
+{
+    return ostr << mi.nrm;
+}
+
+template<typename Eng>
+std::istream& operator>>(std::istream& istr, MutIncrNorm<Eng>& mi)
+{
+    return istr >> mi.nrm;
+}
+
 
 //*********************** Struct MutIncrBiExp ********************************
 
 // Same as previous but with Laplacian distributed increments
 
-template<typename RandEng = std::mt19937>
+template<typename Eng = RandEng>
 struct MutIncrBiExp {
 // public:
-    using rand_eng = RandEng;
+    using rand_eng = Eng;
     using rand_bool = std::bernoulli_distribution;
     using rand_exp = std::exponential_distribution<double>;
     rand_bool bl{0.5};
@@ -61,6 +90,19 @@ struct MutIncrBiExp {
     double StdIncr(rand_eng& eng) { return bl(eng) ? ex(eng) : -ex(eng); }
 };
 
+// Output and input of the state
+template<typename Eng>
+std::ostream& operator<<(std::ostream& ostr, const MutIncrBiExp<Eng>& mi)
+{
+    return ostr << mi.bl << ' ' << mi.ex;
+}
+
+template<typename Eng>
+std::istream& operator>>(std::istream& istr, MutIncrBiExp<Eng>& mi)
+{
+    return istr >> mi.bl >> mi.ex;
+}
+
 
 //*********************** Struct MutRec **************************************
 
@@ -115,12 +157,16 @@ struct Gamete {
     using rho_vec_type = std::array<double, n_loci>;
     static const std::size_t num_loci = n_loci;
     static const std::size_t num_traits = n_loci;
+    static const std::size_t num_cols = n_loci;
     Gamete(gam_data_type&& g = gam_data_type()) : gamdat{g} {}
     Gamete(const gam_data_type& g) : gamdat{g} {}
     const val_type& Value() const { return gamdat; }
     double& operator[](std::size_t i) { return gamdat[i]; }
     double operator[](std::size_t i) const { return gamdat[i]; }
     std::size_t size() const { return gamdat.size(); }
+    // column access, used for binary input and output
+    double Col(std::size_t k) const { return gamdat[k]; }
+    void SetCol(std::size_t k, double v) { gamdat[k] = v; }
     void Mutate(MutRec& mr);
     // public data member
     gam_data_type gamdat;
@@ -191,6 +237,8 @@ std::istream& operator>>(std::istream& istr,
 //    or a const val_type&
 // 5. It has a member function Mutate(mut_rec_type& mr)
 // 6. It has operators << and >> for output and input
+// 7. It has the static member num_cols and member functions
+//    double Col(std::size_t k) and void SetCol(std::size_t k, double v)
 
 template<typename GamType>
 struct Diplotype {
@@ -202,6 +250,7 @@ struct Diplotype {
     using rho_vec_type = typename gam_type::rho_vec_type;
     static const std::size_t num_loci = gam_type::num_loci;
     static const std::size_t num_traits = gam_type::num_traits;
+    static const std::size_t num_cols = 2*gam_type::num_cols;
     Diplotype(gam_type&& g = gam_type()) :
         mat_gam{g}, pat_gam{g} {}
     Diplotype(const gam_type& g) :
@@ -216,11 +265,17 @@ struct Diplotype {
     gam_type& PatGam() { return pat_gam; }
     const gam_type& PatGam() const { return pat_gam; }
     gam_type GetGamete(mut_rec_type& mr) const;
+    // also set bit i of origin if locus i comes from the paternal gamete
+    // (for at most 32 loci)
+    gam_type GetGamete(mut_rec_type& mr, std::uint32_t& origin) const;
     gam_type GetGamete(mut_rec_type& mr,
                       const rho_vec_type& rhov) const;
     val_type Value() const;
     val_type MatVal() const { return mat_gam.Value(); }
     val_type PatVal() const { return pat_gam.Value(); }
+    // column access: maternal columns followed by paternal columns
+    double Col(std::size_t k) const;
+    void SetCol(std::size_t k, double v);
     static std::string ColHeads();
     // public data members
     gam_type mat_gam;
@@ -231,6 +286,16 @@ template<typename GamType>
 typename Diplotype<GamType>::gam_type
 Diplotype<GamType>::GetGamete(mut_rec_type& mr) const
 {
+    std::uint32_t origin;
+    return GetGamete(mr, origin);
+}
+
+template<typename GamType>
+typename Diplotype<GamType>::gam_type
+Diplotype<GamType>::GetGamete(mut_rec_type& mr, std::uint32_t& origin) const
+{
+    static_assert(num_loci <= 32,
+                  "origin has one bit per locus, for at most 32 loci");
     gam_type gam;
     gam_data_type& gam_data = gam.gamdat;
     const gam_data_type& mat_gam_data = mat_gam.gamdat;
@@ -238,10 +303,12 @@ Diplotype<GamType>::GetGamete(mut_rec_type& mr) const
     // random segregation (Mendelian when rho[0] is 0.5)
     bool mat = (mr.uni(mr.eng) < mr.rho[0]);
     gam_data[0] = mat ? mat_gam_data[0] : pat_gam_data[0];
+    origin = mat ? 0 : 1;
     for (std::size_t i = 1; i < gam_data.size(); ++i) {
         // recombination between locus i-1 and locus i
         if (mr.uni(mr.eng) < mr.rho[i]) mat = !mat;
         gam_data[i] = mat ? mat_gam_data[i] : pat_gam_data[i];
+        if (!mat) origin |= std::uint32_t(1) << i;
     }
     // mutation
     gam.Mutate(mr);
@@ -287,6 +354,21 @@ Diplotype<GamType>::Value() const
     return v;
 }
 
+template<typename GamType>
+double Diplotype<GamType>::Col(std::size_t k) const
+{
+    const std::size_t nc = gam_type::num_cols;
+    return (k < nc) ? mat_gam.Col(k) : pat_gam.Col(k - nc);
+}
+
+template<typename GamType>
+void Diplotype<GamType>::SetCol(std::size_t k, double v)
+{
+    const std::size_t nc = gam_type::num_cols;
+    if (k < nc) mat_gam.SetCol(k, v);
+    else pat_gam.SetCol(k - nc, v);
+}
+
 template<typename GamType>
 std::string Diplotype<GamType>::ColHeads()
 {
@@ -345,6 +427,8 @@ std::istream& operator>>(std::istream& istr,
 //    or a const val_type&
 // 5. It has a member function Mutate(mut_rec_type& mr)
 // 6. It has operators << and >> for output and input
+// 7. It has the static member num_cols and member functions
+//    double Col(std::size_t k) and void SetCol(std::size_t k, double v)
 
 template<typename GamType>
 struct Haplotype {
@@ -354,12 +438,15 @@ struct Haplotype {
     using val_type = typename gam_type::val_type;
     static const std::size_t num_loci = gam_type::num_loci;
     static const std::size_t num_traits = gam_type::num_traits;
+    static const std::size_t num_cols = gam_type::num_cols;
     Haplotype(gam_type&& g = gam_type()) : gam{g} {}
     void Assign(gam_type&& g) { gam = g; }
     gam_type& Gam() { return gam; }
     const gam_type& Gam() const { return gam; }
     gam_type GetGamete(mut_rec_type& mr) const;
     val_type Value() const { return gam.Value(); }
+    double Col(std::size_t k) const { return gam.Col(k); }
+    void SetCol(std::size_t k, double v) { gam.SetCol(k, v); }
     static std::string ColHeads();
     // public data member
     gam_type gam;
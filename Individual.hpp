@@ -1,6 +1,7 @@
 #ifndef INDIVIDUAL_HPP
 #define INDIVIDUAL_HPP
 
+#include <cstdint>
 #include <utility>
 #include <string>
 #include <ostream>
@@ -30,7 +31,10 @@
 //    void Assign(gam_type&& gam)
 //    void Assign(gam_type&& mat_gam, gam_type&& pat_gam)
 //    gam_type GetGamete(mut_rec_type& mr)
-// static member function:
+//    double Col(std::size_t k)
+//    void SetCol(std::size_t k, double v)
+// static members:
+//    std::size_t num_cols
 //    std::string ColHeads();
 
 // Assumptions about PhenType
@@ -40,7 +44,10 @@
 // member functions:
 //    void Assign(const GenType& genotype)
 //    bool Female()
-// static member functions
+//    double Col(std::size_t k)
+//    void SetCol(std::size_t k, double v)
+// static members
+//    std::size_t num_cols
 //    std::string ColHeads();
 
 
@@ -81,6 +88,8 @@ struct Individual {
     void Assign(gen_type&& g, phen_type&& ph, std::size_t a_spn, bool a_alive);
     gam_type GetGamete(mut_rec_type& mr) const
     { return genotype.GetGamete(mr); }
+    gam_type GetGamete(mut_rec_type& mr, std::uint32_t& origin) const
+    { return genotype.GetGamete(mr, origin); }
     gam_type GetGamete(mut_rec_type& mr, const rho_vec_type& rho) const
     { return genotype.GetGamete(mr, rho); }
     const gen_type& Genotype() const { return genotype; }
@@ -94,6 +103,12 @@ struct Individual {
     void SetDead() { alive = false; }
     bool Female() const { return phenotype.Female(); }
     void SetFemale(bool female) { phenotype.female = female; }
+    // column access, in the same order as ColHeads(): genotype columns,
+    // phenotype columns, SubPop and Alive
+    static const std::size_t num_cols =
+        gen_type::num_cols + phen_type::num_cols + 2;
+    double Col(std::size_t k) const;
+    void SetCol(std::size_t k, double v);
     static std::string ColHeads();
     // public data members
     gen_type genotype;
@@ -135,6 +150,33 @@ void Individual<GenType, PhenType>::Assign(gen_type&& g, phen_type&& ph,
 }
 
 
+template<typename GenType, typename PhenType>
+double Individual<GenType, PhenType>::Col(std::size_t k) const
+{
+    const std::size_t ngc = gen_type::num_cols;
+    const std::size_t npc = phen_type::num_cols;
+    if (k < ngc) return genotype.Col(k);
+    if (k < ngc + npc) return phenotype.Col(k - ngc);
+    if (k == ngc + npc) return static_cast<double>(spn);
+    return alive;
+}
+
+template<typename GenType, typename PhenType>
+void Individual<GenType, PhenType>::SetCol(std::size_t k, double v)
+{
+    const std::size_t ngc = gen_type::num_cols;
+    const std::size_t npc = phen_type::num_cols;
+    if (k < ngc) {
+        genotype.SetCol(k, v);
+    } else if (k < ngc + npc) {
+        phenotype.SetCol(k - ngc, v);
+    } else if (k == ngc + npc) {
+        spn = static_cast<std::size_t>(v);
+    } else {
+        alive = (v != 0.0);
+    }
+}
+
 template<typename GenType, typename PhenType>
 std::string Individual<GenType, PhenType>::ColHeads()
 {
@@ -51,12 +51,18 @@ void InpFile::LoadSectionsFromFile()
     if (FileName.size() == 0) return;
     std::ifstream inp(FileName.c_str());
     if (!inp.is_open()) return;
+    LoadSections(inp);
+    inp.close();
+}
+
+void InpFile::LoadSections(std::istream& inp)
+{
     std::string SectionName; // Initially, the section name is empty
     std::string Name;
     std::string Value;
     std::string s;
-    getline(inp,s);
-    while (!inp.eof()) {
+    // (a last line without end of line is also used)
+    while (getline(inp,s)) {
         RemoveComments(s);
         Trim(s);
         if (s.size() > 0) {
@@ -77,9 +83,7 @@ void InpFile::LoadSectionsFromFile()
                 }
             }
         }
-        getline(inp,s);
     }
-    inp.close();
     LoadOK = true;
 }
 
@@ -119,6 +123,12 @@ InpFile::InpFile(bool warn) : Warn(warn), LoadOK(false)
     LoadSectionsFromFile();
 }
 
+InpFile::InpFile(std::istream& is, const std::string& name, bool warn) :
+    FileName(name), Warn(warn), LoadOK(false)
+{
+    LoadSections(is);
+}
+
 void InpFile::SaveAs(const std::string& filename)
 {
     FileName = filename;
@@ -140,6 +150,14 @@ void InpFile::Warning(const std::string& Name,
     }
 }
 
+bool InpFile::Contains(const std::string& Name,
+                       const std::string& SectionName) const
+{
+    auto Sit = Sections.find(SectionName);
+    return Sit != Sections.end() &&
+        Sit->second.find(Name) != Sit->second.end();
+}
+
 std::string InpFile::GetValueAsString(const std::string& Name,
                                       const std::string& SectionName) const
 {
@@ -168,3 +186,15 @@ void ReadString(const InpFile& inp, std::string& Value,
 {
    Value = inp.GetValueAsString(Name, SectionName);
 }
+
+// This function can be used to read optional std::strings
+void ReadStringOpt(const InpFile& inp, std::string& Value,
+                   const std::string& Name, const std::string& Default,
+                   const std::string& SectionName)
+{
+    if (inp.Contains(Name, SectionName)) {
+        Value = inp.GetValueAsString(Name, SectionName);
+    } else {
+        Value = Default;
+    }
+}
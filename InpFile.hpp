@@ -42,6 +42,7 @@
 #include <string>
 #include <map>
 #include <sstream>
+#include <istream>
 
 // The EvoProg program runs actor-critic learning simulations
 // Copyright (C) 2019  Olof Leimar
@@ -62,6 +63,9 @@ public:
     explicit InpFile(const std::string& filename, bool warn = true);
     explicit InpFile(const char* filename, bool warn = true);
     explicit InpFile(bool warn = true);
+    // The contents can also be read from a stream, e.g. a std::istringstream
+    // with text held in memory, in which case name is used as file name
+    InpFile(std::istream& is, const std::string& name, bool warn = true);
     const char* GetFileName() const { return FileName.c_str(); }
     void SaveAs(const std::string& filename);
     void Save() const;
@@ -70,11 +74,15 @@ public:
     bool operator!() const { return !LoadOK; }
     void Warning(const std::string& Name,
                  const std::string& SectionName) const;
+    // Returns true if the name is present (in the section), without warning
+    bool Contains(const std::string& Name,
+                  const std::string& SectionName = std::string()) const;
     std::string GetValueAsString(const std::string& Name,
                                  const std::string& SectionName =
                                  std::string()) const;
 private:
     void LoadSectionsFromFile();
+    void LoadSections(std::istream& inp);
     void StoreSectionsInFile() const;
     std::string FileName;
     sec_map_type Sections;
@@ -145,4 +153,23 @@ void ReadString(const InpFile& inp, std::string& Value,
                 const std::string& Name,
                 const std::string& SectionName = std::string());
 
+// The functions below are for optional values: if the name is not present in
+// the file, the value is set to the default, without warning
+template<typename T, typename D>
+void ReadOpt(const InpFile& inp, T& Value, const std::string& Name,
+             const D& Default,
+             const std::string& SectionName = std::string())
+{
+    if (inp.Contains(Name, SectionName)) {
+        Read(inp, Value, Name, SectionName);
+    } else {
+        Value = Default;
+    }
+}
+
+void ReadStringOpt(const InpFile& inp, std::string& Value,
+                   const std::string& Name,
+                   const std::string& Default,
+                   const std::string& SectionName = std::string());
+
 #endif // INPFILE_HPP
@@ -0,0 +1,259 @@
+#ifndef LEARNCACHE_HPP
+#define LEARNCACHE_HPP
+
+#include "PopStats.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+// The EvoProg program runs actor-critic learning simulations
+// Copyright (C) 2019  Olof Leimar
+// See Readme.md for copyright notice
+
+//************************* Class LearnCache ******************************
+
+// This class is an optional cache of learning outcomes, which can be used
+// instead of simulating learning in a group (ActCritGroup::Interact). The
+// outcome of learning in a group depends on the members' real and perceived
+// qualities (q, p) and starting values (w0, theta0), and on the random
+// actions. When only a few loci mutate and q takes a few values, many groups
+// in a generation have (nearly) the same composition. The cache uses a key
+// made from the members' values, rounded to a grid with spacing step (with
+// the members sorted, since their order in the group does not matter), and
+// keeps a reservoir of up to max_samples outcomes from simulated groups with
+// that key. When a key has at least min_samples outcomes, a group is given
+// one of these, drawn at random, instead of being simulated.
+
+// Outcomes from the cache are approximate, because of the rounding, and
+// because the same outcomes are reused. To follow this, a fraction explore
+// of the groups that could use the cache are simulated anyway: the outcome is
+// added to the reservoir (so that it is refreshed), and the difference
+// between a drawn cached outcome and the simulated outcome is recorded for
+// theta, w and payoff (the bias audit). Outcomes older than max_age
+// generations are removed (0: no limit), and the cache is cleared if the
+// number of keys would exceed max_keys.
+
+// The following is assumed about the template parameter PhenType
+// 1. It is assignable
+// 2. It has the following public members of type double:
+//    w0, theta0, q, p (determined before learning), and
+//    w, R, theta, a, payoff, delta, elig, ztheta (results of learning)
+
+// Parameters of a cache
+struct LearnCacheSpec {
+// public:
+    double step = 0.01;
+    std::size_t max_samples = 16;
+    std::size_t min_samples = 4;
+    double explore = 0.05;
+    std::size_t max_age = 0;
+    std::size_t max_keys = 100000;
+};
+
+// Counts of use of a cache, and the bias audit
+struct LearnCacheStats {
+// public:
+    std::uint64_t groups = 0;   // groups looked up
+    std::uint64_t hits = 0;     // groups given a cached outcome
+    std::uint64_t audits = 0;   // groups simulated for the audit
+    std::uint64_t flushes = 0;  // times the cache was cleared
+    RunStat bias_theta;         // cached minus simulated, per member
+    RunStat bias_w;
+    RunStat bias_payoff;
+    void Merge(const LearnCacheStats& o)
+    {
+        groups += o.groups;
+        hits += o.hits;
+        audits += o.audits;
+        flushes += o.flushes;
+        bias_theta.Merge(o.bias_theta);
+        bias_w.Merge(o.bias_w);
+        bias_payoff.Merge(o.bias_payoff);
+    }
+};
+
+template<typename PhenType>
+class LearnCache {
+public:
+    using phen_type = PhenType;
+    using v_type = std::vector<phen_type>;
+    using key_type = std::vector<std::int32_t>;
+    using rand_uni = std::uniform_real_distribution<double>;
+    // Result of looking up a group, to be passed on to Add and Apply
+    struct Probe {
+    // public:
+        key_type key;
+        std::vector<std::size_t> order;  // members in the order of the key
+        bool hit = false;       // use the cached outcome
+        bool audit = false;     // simulate, and compare with cached
+        v_type cached;          // outcome (in the order of the key)
+    };
+    explicit LearnCache(const LearnCacheSpec& a_spec = LearnCacheSpec()) :
+        spec{a_spec} {}
+    // Look up the group memb, in generation gen
+    template<typename Eng>
+    Probe Find(const v_type& memb, int gen, Eng& eng);
+    // Add the outcome of a simulated group (after a miss or an audit)
+    template<typename Eng>
+    void Add(const Probe& pr, const v_type& outcome, int gen, Eng& eng);
+    // Give the members memb the cached outcome of a hit
+    static void Apply(const Probe& pr, v_type& memb);
+    std::size_t NumKeys() const { return cache.size(); }
+    const LearnCacheStats& Stats() const { return stats; }
+private:
+    struct Entry {
+    // public:
+        std::vector<v_type> samples;
+        std::vector<int> sample_gen;
+        std::uint64_t seen = 0;     // outcomes offered to the reservoir
+    };
+    struct KeyHash {
+    // public:
+        std::size_t operator()(const key_type& k) const
+        {
+            // FNV-1a over the values
+            std::uint64_t h = 14695981039346656037ULL;
+            for (std::int32_t v : k) {
+                h ^= static_cast<std::uint32_t>(v);
+                h *= 1099511628211ULL;
+            }
+            return static_cast<std::size_t>(h);
+        }
+    };
+    std::int32_t Grid(double x) const
+    { return static_cast<std::int32_t>(std::lround(x/spec.step)); }
+    static void CopyLearned(phen_type& to, const phen_type& from);
+
+    LearnCacheSpec spec;
+    std::unordered_map<key_type, Entry, KeyHash> cache;
+    LearnCacheStats stats;
+};
+
+template<typename PhenType>
+template<typename Eng>
+typename LearnCache<PhenType>::Probe
+LearnCache<PhenType>::Find(const v_type& memb, int gen, Eng& eng)
+{
+    const std::size_t nv = 4;   // values per member in the key
+    std::size_t g = memb.size();
+    Probe pr;
+    key_type mkey(g*nv);
+    for (std::size_t j = 0; j < g; ++j) {
+        const phen_type& m = memb[j];
+        mkey[j*nv] = Grid(m.q);
+        mkey[j*nv + 1] = Grid(m.p);
+        mkey[j*nv + 2] = Grid(m.w0);
+        mkey[j*nv + 3] = Grid(m.theta0);
+    }
+    // sort members by their part of the key
+    pr.order.resize(g);
+    for (std::size_t j = 0; j < g; ++j) pr.order[j] = j;
+    std::sort(pr.order.begin(), pr.order.end(),
+              [&mkey](std::size_t i, std::size_t j) {
+                  return std::lexicographical_compare(
+                      mkey.begin() + i*nv, mkey.begin() + (i + 1)*nv,
+                      mkey.begin() + j*nv, mkey.begin() + (j + 1)*nv);
+              });
+    pr.key.reserve(g*nv);
+    for (std::size_t j : pr.order) {
+        pr.key.insert(pr.key.end(), mkey.begin() + j*nv,
+                      mkey.begin() + (j + 1)*nv);
+    }
+    ++stats.groups;
+    auto it = cache.find(pr.key);
+    if (it == cache.end()) return pr;
+    Entry& ent = it->second;
+    // remove outcomes that are too old
+    if (spec.max_age > 0) {
+        std::size_t k = 0;
+        for (std::size_t i = 0; i < ent.samples.size(); ++i) {
+            if (gen - ent.sample_gen[i] <= static_cast<int>(spec.max_age)) {
+                if (k != i) {
+                    ent.samples[k] = std::move(ent.samples[i]);
+                    ent.sample_gen[k] = ent.sample_gen[i];
+                }
+                ++k;
+            }
+        }
+        ent.samples.resize(k);
+        ent.sample_gen.resize(k);
+    }
+    if (ent.samples.size() < spec.min_samples || ent.samples.empty()) {
+        return pr;
+    }
+    rand_uni uni(0.0, 1.0);
+    std::size_t i = static_cast<std::size_t>(uni(eng)*ent.samples.size());
+    if (i >= ent.samples.size()) i = ent.samples.size() - 1;
+    pr.cached = ent.samples[i];
+    if (uni(eng) < spec.explore) {
+        pr.audit = true;
+        ++stats.audits;
+    } else {
+        pr.hit = true;
+        ++stats.hits;
+    }
+    return pr;
+}
+
+template<typename PhenType>
+template<typename Eng>
+void LearnCache<PhenType>::Add(const Probe& pr, const v_type& outcome,
+                               int gen, Eng& eng)
+{
+    // outcome in the order of the key
+    v_type sorted;
+    sorted.reserve(outcome.size());
+    for (std::size_t j : pr.order) sorted.push_back(outcome[j]);
+    if (pr.audit) {
+        for (std::size_t k = 0; k < sorted.size(); ++k) {
+            stats.bias_theta.Add(pr.cached[k].theta - sorted[k].theta);
+            stats.bias_w.Add(pr.cached[k].w - sorted[k].w);
+            stats.bias_payoff.Add(pr.cached[k].payoff - sorted[k].payoff);
+        }
+    }
+    if (cache.size() >= spec.max_keys && cache.find(pr.key) == cache.end()) {
+        cache.clear();
+        ++stats.flushes;
+    }
+    Entry& ent = cache[pr.key];
+    ++ent.seen;
+    if (ent.samples.size() < spec.max_samples) {
+        ent.samples.push_back(std::move(sorted));
+        ent.sample_gen.push_back(gen);
+    } else {
+        // reservoir sampling: each outcome offered is kept with equal
+        // probability
+        rand_uni uni(0.0, 1.0);
+        std::uint64_t r = static_cast<std::uint64_t>(uni(eng)*ent.seen);
+        if (r < ent.samples.size()) {
+            ent.samples[r] = std::move(sorted);
+            ent.sample_gen[r] = gen;
+        }
+    }
+}
+
+template<typename PhenType>
+void LearnCache<PhenType>::Apply(const Probe& pr, v_type& memb)
+{
+    for (std::size_t k = 0; k < pr.order.size(); ++k) {
+        CopyLearned(memb[pr.order[k]], pr.cached[k]);
+    }
+}
+
+template<typename PhenType>
+void LearnCache<PhenType>::CopyLearned(phen_type& to, const phen_type& from)
+{
+    to.w = from.w;
+    to.R = from.R;
+    to.theta = from.theta;
+    to.a = from.a;
+    to.payoff = from.payoff;
+    to.delta = from.delta;
+    to.elig = from.elig;
+    to.ztheta = from.ztheta;
+}
+
+#endif // LEARNCACHE_HPP
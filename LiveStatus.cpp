@@ -0,0 +1,252 @@
+#include "LiveStatus.hpp"
+#include "Utils.hpp"
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+// The EvoProg program runs actor-critic learning simulations
+// Copyright (C) 2019  Olof Leimar
+// See Readme.md for copyright notice
+
+namespace {
+
+// interval for checking for requests and updates, in milliseconds
+const int PollMs = 200;
+
+// minimal interval between rewrites of the status file, in seconds
+const double FileSeconds = 1.0;
+
+// write a metric with help and type lines (gauges only)
+void Gauge(std::ostream& os, const char* name, const char* help, double val)
+{
+    os << "# HELP " << name << ' ' << help << '\n'
+       << "# TYPE " << name << " gauge\n"
+       << name << ' ' << val << '\n';
+}
+
+} // namespace
+
+
+//************************** Class LiveStatus ****************************
+
+LiveStatus::LiveStatus() :
+    listen_fd{-1},
+    stop{false},
+    version{0}
+{
+}
+
+bool LiveStatus::Start(const std::string& filename, int port)
+{
+    Stop();
+    file_name = filename;
+    if (port > 0) {
+        listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (listen_fd < 0) {
+            err = std::string("socket: ") + std::strerror(errno);
+            return false;
+        }
+        int yes = 1;
+        setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+        sockaddr_in addr;
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(static_cast<std::uint16_t>(port));
+        // only local connections are accepted
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (bind(listen_fd, reinterpret_cast<sockaddr*>(&addr),
+                 sizeof(addr)) < 0 || listen(listen_fd, 8) < 0) {
+            err = "port " + std::to_string(port) + ": "
+                + std::strerror(errno);
+            close(listen_fd);
+            listen_fd = -1;
+            return false;
+        }
+    }
+    stop = false;
+    thr = std::thread(&LiveStatus::Serve, this);
+    return true;
+}
+
+void LiveStatus::Publish(const LiveInfo& li)
+{
+    if (!Active()) return;
+    std::unique_lock<std::mutex> lock(mtx, std::defer_lock);
+    if (li.done) {
+        lock.lock();
+    } else if (!lock.try_lock()) {
+        return;
+    }
+    info = li;
+    ++version;
+}
+
+void LiveStatus::Stop()
+{
+    if (!Active()) return;
+    stop = true;
+    thr.join();
+    if (listen_fd >= 0) {
+        close(listen_fd);
+        listen_fd = -1;
+    }
+}
+
+// the status thread: answer requests, and rewrite the file when the
+// information has changed (and when stopping)
+void LiveStatus::Serve()
+{
+    using clock_type = std::chrono::steady_clock;
+    clock_type::time_point last_write = clock_type::now();
+    std::size_t written = 0;
+    for (;;) {
+        bool stopping = stop;
+        if (listen_fd >= 0) {
+            pollfd pfd;
+            pfd.fd = listen_fd;
+            pfd.events = POLLIN;
+            pfd.revents = 0;
+            if (poll(&pfd, 1, stopping ? 0 : PollMs) > 0 &&
+                (pfd.revents & POLLIN)) {
+                int fd = accept(listen_fd, nullptr, nullptr);
+                if (fd >= 0) {
+                    Respond(fd);
+                    close(fd);
+                }
+            }
+        } else if (!stopping) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(PollMs));
+        }
+        if (!file_name.empty()) {
+            std::size_t ver;
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                ver = version;
+            }
+            clock_type::time_point now = clock_type::now();
+            double secs =
+                std::chrono::duration<double>(now - last_write).count();
+            if (ver != written && (stopping || secs >= FileSeconds)) {
+                WriteFile();
+                written = ver;
+                last_write = now;
+            }
+        }
+        if (stopping) break;
+    }
+}
+
+// answer an HTTP request: GET /metrics (or /) gives the metrics
+void LiveStatus::Respond(int fd) const
+{
+    timeval tv;
+    tv.tv_sec = 1;
+    tv.tv_usec = 0;
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    std::string req;
+    char buf[1024];
+    while (req.find("\r\n\r\n") == std::string::npos && req.size() < 8192) {
+        ssize_t n = recv(fd, buf, sizeof(buf), 0);
+        if (n <= 0) break;
+        req.append(buf, n);
+    }
+    std::istringstream is(req);
+    std::string method;
+    std::string path;
+    is >> method >> path;
+    std::string status;
+    std::string body;
+    if (method != "GET") {
+        status = "405 Method Not Allowed";
+    } else if (path == "/metrics" || path == "/") {
+        status = "200 OK";
+        body = Metrics();
+    } else {
+        status = "404 Not Found";
+    }
+    std::string resp = "HTTP/1.0 " + status + "\r\n"
+        "Content-Type: text/plain; version=0.0.4\r\n"
+        "Content-Length: " + std::to_string(body.size()) + "\r\n"
+        "Connection: close\r\n\r\n" + body;
+    SendAll(fd, resp);
+}
+
+// the metrics in the Prometheus text format
+std::string LiveStatus::Metrics() const
+{
+    LiveInfo li;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        li = info;
+    }
+    double gens = static_cast<double>(li.gen - li.start_gen);
+    double gens_per_s = (li.elapsed > 0.0) ? gens/li.elapsed : 0.0;
+    double eta = (gens_per_s > 0.0) ? (li.numgen - li.gen)/gens_per_s : 0.0;
+    std::ostringstream os;
+    os.precision(10);
+    Gauge(os, "pggsim_generation",
+          "Number of the latest completed generation", li.gen);
+    Gauge(os, "pggsim_generations", "Total number of generations of the run",
+          li.numgen);
+    Gauge(os, "pggsim_generations_per_hour",
+          "Generations completed per hour in this run", 3600.0*gens_per_s);
+    Gauge(os, "pggsim_eta_seconds",
+          "Estimated time until the run is finished", eta);
+    Gauge(os, "pggsim_elapsed_seconds", "Time since the start of this run",
+          li.elapsed);
+    Gauge(os, "pggsim_learn_steps_per_second",
+          "Individual learning steps per second of wall time",
+          li.steps_per_s);
+    os << "# HELP pggsim_thread_learn_steps_per_second Individual learning "
+       << "steps per second of learning time, per thread\n"
+       << "# TYPE pggsim_thread_learn_steps_per_second gauge\n";
+    for (std::size_t t = 0; t < li.thread_steps_per_s.size(); ++t) {
+        os << "pggsim_thread_learn_steps_per_second{thread=\"" << t << "\"} "
+           << li.thread_steps_per_s[t] << '\n';
+    }
+    Gauge(os, "pggsim_mean_d", "Mean of d after learning", li.mean_d);
+    Gauge(os, "pggsim_mean_theta", "Mean of theta after learning",
+          li.mean_theta);
+    Gauge(os, "pggsim_resident_memory_bytes", "Resident memory of the process",
+          static_cast<double>(ResidentBytes()));
+    Gauge(os, "pggsim_done", "Whether the run has finished", li.done);
+    return os.str();
+}
+
+bool LiveStatus::WriteFile() const
+{
+    std::string tmp_name = file_name + ".tmp";
+    {
+        std::ofstream os(tmp_name.c_str());
+        os << Metrics();
+        if (!os) return false;
+    }
+    return std::rename(tmp_name.c_str(), file_name.c_str()) == 0;
+}
+
+
+//**************************** Memory ************************************
+
+std::size_t ResidentBytes()
+{
+#ifdef __linux__
+    // the second field of statm is the number of resident pages
+    std::ifstream is("/proc/self/statm");
+    std::size_t size = 0;
+    std::size_t resident = 0;
+    if (is >> size >> resident) {
+        return resident*static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    }
+#endif
+    return 0;
+}
@@ -0,0 +1,82 @@
+#ifndef LIVESTATUS_HPP
+#define LIVESTATUS_HPP
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// The EvoProg program runs actor-critic learning simulations
+// Copyright (C) 2019  Olof Leimar
+// See Readme.md for copyright notice
+
+// This unit makes the progress of a running simulation available to other
+// programs, as metrics in the Prometheus text format. The metrics are the
+// current generation, generations per hour, the estimated time remaining, the
+// learning throughput of each thread, the mean d and theta after learning,
+// and the resident memory of the process. They can be written to a status
+// file, which is rewritten atomically (through a temporary file and a rename)
+// at most once per second, and served over HTTP on the loopback interface.
+// The simulation threads only hand over a copy of the current information;
+// the file writing and HTTP requests are handled by a separate thread.
+
+//*************************** Struct LiveInfo ****************************
+
+// Information about the progress of a run
+
+struct LiveInfo {
+// public:
+    std::string inp_name;
+    std::size_t gen = 0;        // number of the latest completed generation
+    std::size_t start_gen = 0;  // generations completed before this run
+    std::size_t numgen = 0;     // total number of generations
+    double elapsed = 0.0;       // seconds since the start of this run
+    double steps_per_s = 0.0;   // learning steps per second, all threads
+    std::vector<double> thread_steps_per_s;  // per thread, in learn phase
+    double mean_d = 0.0;        // mean d after learning
+    double mean_theta = 0.0;    // mean theta after learning
+    bool done = false;          // whether the run has finished
+};
+
+
+//************************** Class LiveStatus ****************************
+
+class LiveStatus {
+public:
+    LiveStatus();
+    ~LiveStatus() { Stop(); }
+    LiveStatus(const LiveStatus&) = delete;
+    LiveStatus& operator=(const LiveStatus&) = delete;
+    // Start the status thread, writing to filename (if not empty) and
+    // serving HTTP on 127.0.0.1:port (if port > 0); returns false if the
+    // port could not be opened
+    bool Start(const std::string& filename, int port);
+    bool Active() const { return thr.joinable(); }
+    const std::string& Error() const { return err; }
+    // Hand over the current information; if the status thread is busy
+    // copying the previous information, this update is skipped (except
+    // when li.done is true)
+    void Publish(const LiveInfo& li);
+    // Write the final status and stop the status thread
+    void Stop();
+private:
+    void Serve();
+    void Respond(int fd) const;
+    std::string Metrics() const;
+    bool WriteFile() const;
+
+    std::string file_name;
+    int listen_fd;
+    std::string err;
+    std::thread thr;
+    std::atomic<bool> stop;
+    mutable std::mutex mtx;     // protects info and version
+    LiveInfo info;
+    std::size_t version;
+};
+
+// Resident memory of the process in bytes (0 if not known)
+std::size_t ResidentBytes();
+
+#endif // LIVESTATUS_HPP
@@ -0,0 +1,79 @@
+#include "MemReport.hpp"
+#include <iomanip>
+#include <sys/resource.h>
+#include <unistd.h>
+
+// The EvoProg program runs actor-critic learning simulations
+// Copyright (C) 2019  Olof Leimar
+// See Readme.md for copyright notice
+
+//*************************** Class MemReport ****************************
+
+void MemReport::Add(const std::string& name, double bytes)
+{
+    for (auto& it : items) {
+        if (it.first == name) {
+            it.second += bytes;
+            return;
+        }
+    }
+    items.emplace_back(name, bytes);
+}
+
+double MemReport::Bytes(const std::string& name) const
+{
+    for (const auto& it : items) {
+        if (it.first == name) return it.second;
+    }
+    return 0.0;
+}
+
+double MemReport::Total() const
+{
+    double sum = 0.0;
+    for (const auto& it : items) sum += it.second;
+    return sum;
+}
+
+void MemReport::Write(std::ostream& os, const std::string& title,
+                      double peak_rss) const
+{
+    std::ios_base::fmtflags flags = os.flags();
+    std::streamsize prec = os.precision();
+    os << std::fixed << std::setprecision(1);
+    os << "Memory (" << title << "): " << Total()/1.0e6 << " MB";
+    if (peak_rss > 0.0) os << ", peak RSS " << peak_rss/1.0e6 << " MB";
+    os << '\n' << " ";
+    for (std::size_t k = 0; k < items.size(); ++k) {
+        os << (k > 0 ? ", " : " ") << items[k].first << ' '
+           << items[k].second/1.0e6;
+    }
+    os << '\n';
+    os.flags(flags);
+    os.precision(prec);
+}
+
+double PeakRSS()
+{
+    rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) != 0) return 0.0;
+#ifdef __APPLE__
+    // bytes on macOS
+    return static_cast<double>(ru.ru_maxrss);
+#else
+    // kilobytes on Linux
+    return 1024.0*ru.ru_maxrss;
+#endif
+}
+
+double PhysMem()
+{
+#if defined(_SC_PHYS_PAGES) && defined(_SC_PAGESIZE)
+    long pages = sysconf(_SC_PHYS_PAGES);
+    long page_size = sysconf(_SC_PAGESIZE);
+    if (pages > 0 && page_size > 0) {
+        return static_cast<double>(pages)*page_size;
+    }
+#endif
+    return 0.0;
+}
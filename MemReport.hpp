@@ -0,0 +1,45 @@
+#ifndef MEMREPORT_HPP
+#define MEMREPORT_HPP
+
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// The EvoProg program runs actor-critic learning simulations
+// Copyright (C) 2019  Olof Leimar
+// See Readme.md for copyright notice
+
+// This unit accounts for the memory held by the main data structures of a
+// run (the populations, per-thread buffers, random number engines, I/O
+// buffers and so on), as a list of named items. Before a simulation is set
+// up, the items can be predicted from the input parameters, so that a run
+// that would not fit in memory stops at once, instead of being killed by the
+// operating system later on, and at the end of a run the sizes actually held
+// are reported, together with the peak resident set size of the process.
+
+
+//*************************** Class MemReport ****************************
+
+class MemReport {
+public:
+    // Add bytes to item name (a new item, if there is none with the name)
+    void Add(const std::string& name, double bytes);
+    double Bytes(const std::string& name) const;
+    double Total() const;
+    const std::vector<std::pair<std::string, double>>& Items() const
+    { return items; }
+    // Write the total and the items, in MB, on two lines headed by title,
+    // adding the peak resident set size if it is positive
+    void Write(std::ostream& os, const std::string& title,
+               double peak_rss = 0.0) const;
+private:
+    std::vector<std::pair<std::string, double>> items;
+};
+
+// Peak resident set size of this process, and physical memory of the
+// computer, in bytes (0 if not available)
+double PeakRSS();
+double PhysMem();
+
+#endif // MEMREPORT_HPP
@@ -2,9 +2,18 @@
 #define METAPOPSTATE_HPP
 
 #include <vector>
+#include <algorithm>
 #include <string>
 #include <iostream>
 #include <fstream>
+#include <cstdio>
+#include <cstdint>
+#include <cmath>
+#include <random>
+#include <sstream>
+#include "PopBinFile.hpp"
+#include "TextWriter.hpp"
+#include "TextReader.hpp"
 
 // The EvoProg program runs actor-critic learning simulations
 // Copyright (C) 2019  Olof Leimar
@@ -127,11 +136,134 @@ void SubPop0<Individual, State>::swap(SubPop0<Individual, State>& other_pop)
 }
 
 
+//*************************** IndexBits *****************************
+
+// Packed bits, one per position in a subpopulation container, used by SubPop1
+// and SubPop2 to record which positions hold living individuals (and which
+// of these are female). Counts are found with popcount, and the set positions
+// are visited in order by scanning for the lowest set bit of each 64-bit word,
+// so that iteration skips runs of dead positions 64 at a time.
+
+struct IndexBits {
+// public:
+    void Assign(std::size_t n) { w.assign((n + 63)/64, 0); }
+    void clear() { std::fill(w.begin(), w.end(), std::uint64_t(0)); }
+    void Set(std::size_t i) { w[i/64] |= std::uint64_t(1) << (i % 64); }
+    void Reset(std::size_t i) { w[i/64] &= ~(std::uint64_t(1) << (i % 64)); }
+    // set positions 0 to n - 1 and reset all others
+    void SetFirst(std::size_t n);
+    bool Test(std::size_t i) const { return (w[i/64] >> (i % 64)) & 1; }
+    // number of set bits
+    std::size_t Count() const;
+    // number of set bits that are also set in other
+    std::size_t CountAnd(const IndexBits& other) const;
+    // first set position >= i, or i_end if there is none below i_end
+    std::size_t Next(std::size_t i, std::size_t i_end) const;
+    // one past the last set position below i_end (0 if there is none)
+    std::size_t End(std::size_t i_end) const;
+    // call f(i) for each set position i < i_end, in increasing order
+    template <typename F>
+    void ForEach(std::size_t i_end, F&& f) const;
+    // call f(i) for each position i < i_end that is set here and in other
+    // (if in_other is true) or set here and not in other (if false)
+    template <typename F>
+    void ForEachAnd(const IndexBits& other, bool in_other,
+                    std::size_t i_end, F&& f) const;
+    void swap(IndexBits& other) { w.swap(other.w); }
+    // public data members
+    std::vector<std::uint64_t> w;
+};
+
+inline void IndexBits::SetFirst(std::size_t n)
+{
+    for (std::size_t k = 0; k < w.size(); ++k) {
+        if (64*k + 64 <= n) w[k] = ~std::uint64_t(0);
+        else if (64*k < n) w[k] = (std::uint64_t(1) << (n % 64)) - 1;
+        else w[k] = 0;
+    }
+}
+
+inline std::size_t IndexBits::Count() const
+{
+    std::size_t n = 0;
+    for (std::uint64_t x : w) n += __builtin_popcountll(x);
+    return n;
+}
+
+inline std::size_t IndexBits::CountAnd(const IndexBits& other) const
+{
+    std::size_t n = 0;
+    for (std::size_t k = 0; k < w.size(); ++k) {
+        n += __builtin_popcountll(w[k] & other.w[k]);
+    }
+    return n;
+}
+
+inline std::size_t IndexBits::Next(std::size_t i, std::size_t i_end) const
+{
+    if (i >= i_end) return i_end;
+    std::size_t k = i/64;
+    std::uint64_t x = w[k] & (~std::uint64_t(0) << (i % 64));
+    std::size_t k_end = (i_end + 63)/64;
+    while (x == 0) {
+        if (++k >= k_end) return i_end;
+        x = w[k];
+    }
+    std::size_t j = 64*k + __builtin_ctzll(x);
+    return (j < i_end) ? j : i_end;
+}
+
+inline std::size_t IndexBits::End(std::size_t i_end) const
+{
+    std::size_t k = (i_end + 63)/64;
+    while (k > 0) {
+        --k;
+        std::uint64_t x = w[k];
+        if (64*k + 64 > i_end) x &= (std::uint64_t(1) << (i_end % 64)) - 1;
+        if (x != 0) return 64*k + 64 - __builtin_clzll(x);
+    }
+    return 0;
+}
+
+template <typename F>
+void IndexBits::ForEach(std::size_t i_end, F&& f) const
+{
+    std::size_t k_end = (i_end + 63)/64;
+    for (std::size_t k = 0; k < k_end; ++k) {
+        std::uint64_t x = w[k];
+        while (x != 0) {
+            std::size_t i = 64*k + __builtin_ctzll(x);
+            if (i >= i_end) return;
+            f(i);
+            x &= x - 1;
+        }
+    }
+}
+
+template <typename F>
+void IndexBits::ForEachAnd(const IndexBits& other, bool in_other,
+                           std::size_t i_end, F&& f) const
+{
+    std::size_t k_end = (i_end + 63)/64;
+    for (std::size_t k = 0; k < k_end; ++k) {
+        std::uint64_t x = w[k] & (in_other ? other.w[k] : ~other.w[k]);
+        while (x != 0) {
+            std::size_t i = 64*k + __builtin_ctzll(x);
+            if (i >= i_end) return;
+            f(i);
+            x &= x - 1;
+        }
+    }
+}
+
+
 //*************************** SubPop1 *******************************
 
 // This is a container for a subpopulation. The methods Add() and Remove()
 // ensure that all individuals that are 'present' in the subpopulation are
-// 'alive'.
+// 'alive'. Which positions hold living individuals is also kept in packed
+// bits, so that the living individuals can be visited without testing each
+// position, and so that the container can be compacted.
 
 // NOTE: The class has a non-const operator[](std::size_t) but access through
 // this operator should not be used to set individuals alive or dead, since
@@ -139,7 +271,14 @@ void SubPop0<Individual, State>::swap(SubPop0<Individual, State>& other_pop)
 // instead to allow other kinds of changes of an individual's state.
 
 // It is possible to iterate over the members of a SubPop1 sp as follows:
+// sp.ForEachLive([&sp](std::size_t i) { ... sp[i] ... });
+// or
+// for (std::size_t i = sp.First(); i < sp.Iend(); i = sp.Next(i + 1)) ...
+// or, as before the bits were introduced,
 // for (int i = 0; i < sp.Iend(); ++i) if (sp[i].Alive()) ...
+// After deaths have fragmented the container, Compact() moves the living
+// individuals (in order) to the start, so that indices 0 to NumInds() - 1
+// are alive; indices kept from before are then no longer valid.
 
 // Assumptions about template parameter class Individual:
 // 1. It has a default constructor (should construct "dead" individual)
@@ -163,7 +302,10 @@ public:
         free(max_inds),
         num_free{max_inds},
         i_end{0}
-    { for (std::size_t k = 0; k < max_inds; ++k) free[k] = max_inds - 1 - k; }
+    {
+        for (std::size_t k = 0; k < max_inds; ++k) free[k] = max_inds - 1 - k;
+        live.Assign(max_inds);
+    }
     void Assign(std::size_t max_inds = 0);
     void clear();
     Individual& operator[](std::size_t i ) { return ind[i]; }
@@ -172,8 +314,18 @@ public:
     std::size_t MaxInds() const { return ind.size(); }
     bool Full() const { return (num_free == 0); }
     std::size_t Iend() const { return i_end; }
+    bool Alive(std::size_t i) const { return live.Test(i); }
+    // first living index >= i, or Iend() if there is none
+    std::size_t Next(std::size_t i) const { return live.Next(i, i_end); }
+    std::size_t First() const { return live.Next(0, i_end); }
+    // call f(i) for the index i of each living individual, in order
+    template <typename F>
+    void ForEachLive(F&& f) const { live.ForEach(i_end, f); }
+    // number of living individuals, counted from the bits
+    std::size_t CountLive() const { return live.Count(); }
     void Add(const Individual& indi);
     void Remove(std::size_t i);
+    void Compact();
     State& GetState() { return st; }
     // Swap the individuals (but not the state) of subpops
     void swap(SubPop1<Individual, State>& other_pop);
@@ -183,6 +335,7 @@ private:
     std::vector<std::size_t> free;
     std::size_t num_free;
     std::size_t i_end;
+    IndexBits live;
     State st;
 };
 
@@ -194,12 +347,14 @@ void SubPop1<Individual,State>::Assign(std::size_t max_inds)
     num_free = max_inds;
     i_end = 0;
     for (std::size_t k = 0; k < max_inds; ++k) free[k] = max_inds - 1 - k;
+    live.Assign(max_inds);
 }
 
 template <typename Individual, typename State>
 void SubPop1<Individual,State>::clear()
 {
-    for (std::size_t i = 0; i < ind.size(); ++i) ind[i].SetDead();
+    live.ForEach(i_end, [this](std::size_t i) { ind[i].SetDead(); });
+    live.clear();
     for (std::size_t k = 0; k < ind.size(); ++k) free[k] = ind.size() - 1 - k;
     num_free = ind.size();
     i_end = 0;
@@ -213,6 +368,7 @@ void SubPop1<Individual,State>::Add(const Individual& indi)
         std::size_t i = free[num_free];
         ind[i] = indi;
         ind[i].SetAlive();
+        live.Set(i);
         if (i >= i_end) i_end = i + 1;
     }
 }
@@ -220,24 +376,42 @@ void SubPop1<Individual,State>::Add(const Individual& indi)
 template <typename Individual, typename State>
 void SubPop1<Individual,State>::Remove(std::size_t i)
 {
-    if (ind[i].Alive()) {
+    if (live.Test(i)) {
         free[num_free] = i;
         ++num_free;
         ind[i].SetDead();
-        if (i == i_end - 1) {
-            --i_end;
-            while (i_end > 0 && !ind[i_end - 1].Alive()) --i_end;
-        }
+        live.Reset(i);
+        if (i == i_end - 1) i_end = live.End(i_end);
     }
 }
 
+template <typename Individual, typename State>
+void SubPop1<Individual,State>::Compact()
+{
+    // move living individuals down to the first free positions, keeping
+    // their order, and let the free positions follow them
+    std::size_t n = 0;
+    live.ForEach(i_end, [this, &n](std::size_t i) {
+        if (i != n) {
+            ind[n] = std::move(ind[i]);
+            ind[i].SetDead();
+        }
+        ++n;
+    });
+    live.SetFirst(n);
+    i_end = n;
+    num_free = ind.size() - n;
+    for (std::size_t k = 0; k < num_free; ++k) free[k] = ind.size() - 1 - k;
+}
+
 template <typename Individual, typename State>
 void SubPop1<Individual,State>::swap(SubPop1<Individual,State>& other_pop)
 {
     // Swap the individuals (but not the state) of subpops
-    // swap subpops and free indicator
+    // swap subpops, free indicator and bits
     ind.swap(other_pop.ind);
     free.swap(other_pop.free);
+    live.swap(other_pop.live);
     // swap num_free and i_end
     std::size_t save = num_free;
     num_free = other_pop.num_free;
@@ -256,16 +430,13 @@ void SubPop1<Individual,State>::swap(SubPop1<Individual,State>& other_pop)
 // Assumptions about template parameter class SubPop:
 // 1. Member functions:
 //       std::size_t NumInds()
-//       std::size_t Iend()
-//       const Individual& operator[](std::size_t)
-//       where the type Individual has a member function
-//       bool Alive()
+//       void ForEachLive(F f), calling f(i) for each living individual i
 
 template <typename SubPop>
 class SubPopStruct1
 {
 public:
-    SubPopStruct1(const SubPop& sub_pop);
+    SubPopStruct1(const SubPop& sub_pop) { Assign(sub_pop); }
     void Assign(const SubPop& sub_pop);
     std::size_t N() const { return n; }
     std::size_t Index(std::size_t k) const { return alive_sub_pop[k]; }
@@ -275,28 +446,16 @@ private:
     std::size_t n;
 };
 
-template <typename SubPop>
-SubPopStruct1<SubPop>::
-SubPopStruct1(const SubPop& sub_pop) :
-    alive_sub_pop(sub_pop.NumInds()),
-    n(sub_pop.NumInds())
-{
-    std::size_t k = 0;
-    for (std::size_t i = 0; i < sub_pop.Iend(); ++i) {
-        if (sub_pop[i].Alive()) alive_sub_pop[k++] = i;
-    }
-}
-
 template <typename SubPop>
 void SubPopStruct1<SubPop>::
 Assign(const SubPop& sub_pop)
 {
-    alive_sub_pop.assign(sub_pop.NumInds(), 0);
+    alive_sub_pop.resize(sub_pop.NumInds());
     n = sub_pop.NumInds();
     std::size_t k = 0;
-    for (std::size_t i = 0; i < sub_pop.Iend(); ++i) {
-        if (sub_pop[i].Alive()) alive_sub_pop[k++] = i;
-    }
+    sub_pop.ForEachLive([this, &k](std::size_t i) {
+        alive_sub_pop[k++] = i;
+    });
 }
 
 template <typename SubPop>
@@ -319,7 +478,8 @@ UpdateDeath(std::size_t k)
 
 // This is a container for a subpopulation of individuals with two sexes. The
 // methods Add() and Remove() ensure that all individuals that are 'present' in
-// the subpopulation are 'alive'.
+// the subpopulation are 'alive'. As for SubPop1, which positions hold living
+// individuals, and which of these are female, is also kept in packed bits.
 
 // NOTE: The class has a non-const operator[](std::size_t) but access through
 // this operator should not be used to set individuals alive or dead, since
@@ -329,7 +489,11 @@ UpdateDeath(std::size_t k)
 // individual's state.
 
 // It is possible to iterate over the members of a SubPop2 sp as follows:
+// sp.ForEachLive([&sp](std::size_t i) { ... sp[i] ... });
+// and over females and males with ForEachFemale() and ForEachMale(), or as
+// for SubPop1 with First() and Next(), or
 // for (int i = 0; i < sp.Iend(); ++i) if (sp[i].Alive()) ...
+// Compact() works as for SubPop1.
 
 // Assumptions about template parameter class Individual:
 // 1. It has a default constructor (should construct "dead" individual)
@@ -356,7 +520,11 @@ public:
         i_end{0},
         nf{0},
         nm{0}
-    { for (std::size_t k = 0; k < max_inds; ++k) free[k] = max_inds - 1 - k; }
+    {
+        for (std::size_t k = 0; k < max_inds; ++k) free[k] = max_inds - 1 - k;
+        live.Assign(max_inds);
+        fem.Assign(max_inds);
+    }
     void Assign(std::size_t max_inds = 0);
     void clear();
     Individual& operator[](std::size_t i ) { return ind[i]; }
@@ -367,8 +535,25 @@ public:
     std::size_t Iend() const { return i_end; }
     std::size_t Nf() const { return nf; }
     std::size_t Nm() const { return nm; }
+    bool Alive(std::size_t i) const { return live.Test(i); }
+    bool Female(std::size_t i) const { return fem.Test(i); }
+    // first living index >= i, or Iend() if there is none
+    std::size_t Next(std::size_t i) const { return live.Next(i, i_end); }
+    std::size_t First() const { return live.Next(0, i_end); }
+    // call f(i) for the index i of each living individual (or female or
+    // male), in order
+    template <typename F>
+    void ForEachLive(F&& f) const { live.ForEach(i_end, f); }
+    template <typename F>
+    void ForEachFemale(F&& f) const { live.ForEachAnd(fem, true, i_end, f); }
+    template <typename F>
+    void ForEachMale(F&& f) const { live.ForEachAnd(fem, false, i_end, f); }
+    // numbers of living individuals and females, counted from the bits
+    std::size_t CountLive() const { return live.Count(); }
+    std::size_t CountFemale() const { return live.CountAnd(fem); }
     void Add(const Individual& indi);
     void Remove(std::size_t i);
+    void Compact();
     State& GetState() { return st; }
     // Swap the individuals (but not the state) of subpops
     void swap(SubPop2<Individual,State>& other_pop);
@@ -380,6 +565,8 @@ private:
     std::size_t i_end;
     std::size_t nf;
     std::size_t nm;
+    IndexBits live;
+    IndexBits fem;
     State st;
 };
 
@@ -393,12 +580,16 @@ void SubPop2<Individual, State>::Assign(std::size_t max_inds)
     nf = 0;
     nm = 0;
     for (std::size_t k = 0; k < max_inds; ++k) free[k] = max_inds - 1 - k;
+    live.Assign(max_inds);
+    fem.Assign(max_inds);
 }
 
 template <typename Individual, typename State>
 void SubPop2<Individual, State>::clear()
 {
-    for (std::size_t i = 0; i < ind.size(); ++i) ind[i].SetDead();
+    live.ForEach(i_end, [this](std::size_t i) { ind[i].SetDead(); });
+    live.clear();
+    fem.clear();
     for (std::size_t k = 0; k < ind.size(); ++k) free[k] = ind.size() - 1 - k;
     num_free = ind.size();
     i_end = 0;
@@ -414,35 +605,63 @@ void SubPop2<Individual, State>::Add(const Individual& indi)
         std::size_t i = free[num_free];
         ind[i] = indi;
         ind[i].SetAlive();
+        live.Set(i);
         if (i >= i_end) i_end = i + 1;
-        if (ind[i].Female()) ++nf;
-        else ++nm;
+        if (ind[i].Female()) {
+            fem.Set(i);
+            ++nf;
+        } else {
+            fem.Reset(i);
+            ++nm;
+        }
     }
 }
 
 template <typename Individual, typename State>
 void SubPop2<Individual, State>::Remove(std::size_t i)
 {
-   if (ind[i].Alive()) {
+   if (live.Test(i)) {
         free[num_free] = i;
-        if ( ind[i].Female() ) --nf;
+        if ( fem.Test(i) ) --nf;
         else --nm;
         ++num_free;
         ind[i].SetDead();
-        if ( i == i_end - 1 ) {
-            --i_end;
-            while (i_end > 0 && !ind[i_end - 1].Alive()) --i_end;
-        }
+        live.Reset(i);
+        if ( i == i_end - 1 ) i_end = live.End(i_end);
     }
 }
 
+template <typename Individual, typename State>
+void SubPop2<Individual, State>::Compact()
+{
+    // move living individuals down to the first free positions, keeping
+    // their order, and let the free positions follow them; the sex bits
+    // are moved along (position n is never above the one read)
+    std::size_t n = 0;
+    live.ForEach(i_end, [this, &n](std::size_t i) {
+        if (i != n) {
+            ind[n] = std::move(ind[i]);
+            ind[i].SetDead();
+            if (fem.Test(i)) fem.Set(n);
+            else fem.Reset(n);
+        }
+        ++n;
+    });
+    live.SetFirst(n);
+    i_end = n;
+    num_free = ind.size() - n;
+    for (std::size_t k = 0; k < num_free; ++k) free[k] = ind.size() - 1 - k;
+}
+
 template <typename Individual, typename State>
 void SubPop2<Individual, State>::swap(SubPop2<Individual,State>& other_pop)
 {
     // Swap the individuals (but not the state) of subpops
-    // swap subpops and free indicator
+    // swap subpops, free indicator and bits
     ind.swap(other_pop.ind);
     free.swap(other_pop.free);
+    live.swap(other_pop.live);
+    fem.swap(other_pop.fem);
     // swap num_free and i_end
     std::size_t save = num_free;
     num_free = other_pop.num_free;
@@ -469,17 +688,14 @@ void SubPop2<Individual, State>::swap(SubPop2<Individual,State>& other_pop)
 //       std::size_t NumInds()
 //       std::size_t Nf()
 //       std::size_t Nm()
-//       std::size_t Iend()
-//       const Individual& operator[](std::size_t)
-//       where the type Individual has a member function
-//       bool Alive()
-//       bool Female()
+//       void ForEachFemale(F f), calling f(i) for each living female i
+//       void ForEachMale(F f), calling f(i) for each living male i
 
 template <typename SubPop>
 class SubPopStruct2
 {
 public:
-    SubPopStruct2(const SubPop& sub_pop);
+    SubPopStruct2(const SubPop& sub_pop) { Assign(sub_pop); }
     void Assign(const SubPop& sub_pop);
     std::size_t N() const { return n; }
     std::size_t Nf() const { return nf; }
@@ -496,42 +712,19 @@ private:
     std::size_t nm;
 };
 
-template <typename SubPop>
-SubPopStruct2<SubPop>::
-SubPopStruct2(const SubPop& sub_pop) :
-    female(sub_pop.Nf()),
-    male(sub_pop.Nm()),
-    n(sub_pop.NumInds()),
-    nf(sub_pop.Nf()),
-    nm(sub_pop.Nm())
-{
-    std::size_t kf = 0;
-    std::size_t km = 0;
-    for (std::size_t i = 0; i < sub_pop.Iend(); ++i) {
-        if ( sub_pop[i].Alive() ) {
-            if ( sub_pop[i].Female() ) female[kf++] = i;
-            else male[km++] = i;
-        }
-    }
-}
-
 template <typename SubPop>
 void SubPopStruct2<SubPop>::
 Assign(const SubPop& sub_pop)
 {
-    female.assign(sub_pop.Nf(), 0);
-    male.assign(sub_pop.Nm(), 0);
+    female.resize(sub_pop.Nf());
+    male.resize(sub_pop.Nm());
     n = sub_pop.NumInds();
     nf = sub_pop.Nf();
     nm = sub_pop.Nm();
     std::size_t kf = 0;
     std::size_t km = 0;
-    for (std::size_t i = 0; i < sub_pop.Iend(); ++i) {
-        if (sub_pop[i].Alive()) {
-            if (sub_pop[i].Female()) female[kf++] = i;
-            else male[km++] = i;
-        }
-    }
+    sub_pop.ForEachFemale([this, &kf](std::size_t i) { female[kf++] = i; });
+    sub_pop.ForEachMale([this, &km](std::size_t i) { male[km++] = i; });
 }
 
 template <typename SubPop>
@@ -588,10 +781,31 @@ UpdateDeathM(std::size_t k)
 // 2. Member functions:
 //       bool Alive()
 //       std::size_t SubPopNum()
-// 3. Static member function
+//       double Col(std::size_t k)
+//       void SetCol(std::size_t k, double v)
+// 3. Static members
+//       std::size_t num_cols
 //       std::string ColHeads()
 // 4. Input and output operators >> and <<
 
+// Files with names ending in PopBinExt (see PopBinFile.hpp) are read and
+// written in the binary format, other files as tab-separated text; text
+// output is written with the given precision (see TextWriter.hpp), and is
+// compressed if the file name ends in .gz
+
+// Options for writing a MetaPopState to file: the indices of the columns to
+// write (all columns if empty), the fraction of the individuals in each
+// subpopulation to write (a random sample without replacement, drawn using
+// seed, and kept in population order), and the precision of text output
+
+struct PopOutSpec {
+// public:
+    std::vector<std::size_t> cols;
+    double sample_rate = 1.0;
+    unsigned seed = 0;
+    int prec = 6;
+};
+
 template <typename SubPop>
 class MetaPopState
 {
@@ -606,8 +820,41 @@ public:
     void swap(MetaPopState<SubPop>& other_pop);
     // Read_from_File checks that subpopulation numbers are valid
     bool Read_from_File(const std::string& infilename, std::size_t n);
-    void Write_to_File(const std::string& outfilename) const;
+    // (the Write functions return false, with a message, if they fail)
+    bool Write_to_File(const std::string& outfilename, int prec = 6) const;
+    bool Write_to_File(const std::string& outfilename,
+                       const PopOutSpec& spec) const;
+    // Read from, or write to, the binary format, using data in memory or an
+    // open file (for instance as part of a checkpoint file)
+    bool Read_from_Bin(const PopBinView& pbv, std::size_t n);
+    bool Write_to_Bin(std::FILE* fp) const;
+    // Get the values of the columns given by spec (all columns if spec.cols
+    // is empty) for the individuals selected by spec, one vector per column
+    void Columns(const PopOutSpec& spec,
+                 std::vector<std::vector<double>>& data) const;
+    // Set cols to the indices of the blank-separated column names in names,
+    // returning false (with a message) if a name is not a column head
+    static bool ColIndices(const std::string& names,
+                           std::vector<std::size_t>& cols);
+    // Put the text rows of the individuals selected by spec, with the
+    // columns cols, drawing the sample with eng; a population can be
+    // written in parts in this way (Write_to_File uses eng(spec.seed))
+    void Put_Rows(TextWriter& tw, const std::vector<std::size_t>& cols,
+                  const PopOutSpec& spec, std::mt19937& eng) const;
 private:
+    bool Read_from_BinFile(const std::string& infilename, std::size_t n);
+    bool Write_to_BinFile(const std::string& outfilename,
+                          const std::vector<std::size_t>& cols,
+                          const std::vector<std::vector<std::size_t>>& rows)
+        const;
+    bool WriteBin(std::FILE* fp,
+                  const std::vector<std::size_t>& cols,
+                  const std::vector<std::vector<std::size_t>>& rows) const;
+    std::vector<std::vector<std::size_t>> OutRows(const PopOutSpec& spec)
+        const;
+    std::vector<std::vector<std::size_t>> OutRows(const PopOutSpec& spec,
+                                                  std::mt19937& eng) const;
+    bool Insert(const ind_type& indi, std::size_t& n_inds);
     std::vector<SubPop> sub_pop;
 };
 
@@ -623,50 +870,116 @@ void MetaPopState<SubPop>::swap(MetaPopState<SubPop>& other_pop)
     sub_pop.swap(other_pop.sub_pop);
 }
 
+// insert individual in the subpopulation given by its subpopulation number,
+// checking that the number is valid and that the subpopulation is not full
+template <typename SubPop>
+bool MetaPopState<SubPop>::Insert(const ind_type& indi, std::size_t& n_inds)
+{
+    bool OK = true;
+    std::size_t spn = indi.SubPopNum();
+    // check if subpopulation number is valid
+    if (spn < sub_pop.size()) {
+        if (!sub_pop[spn].Full()) {
+            if (indi.Alive()) {
+                sub_pop[spn].Add(indi);
+                ++n_inds; // count individuals read
+            }
+        } else {
+            std::cerr << "Subpopulation number "
+                      << spn
+                      << " is full\n";
+            OK = false;
+        }
+    } else {
+        std::cerr << "Individual\n"
+                  << indi
+                  << "\nhas invalid subpopulation number: "
+                  << spn << '\n';
+        OK = false;
+    }
+    return OK;
+}
+
 template <typename SubPop>
 bool MetaPopState<SubPop>::Read_from_File(const std::string& infilename,
                                           std::size_t n)
 {
+    if (IsPopBinName(infilename)) {
+        return Read_from_BinFile(infilename, n);
+    }
     bool OK = true;
     std::size_t n_inds = 0;
-    std::ifstream infile(infilename.c_str());
-    if (!infile) {
+    TextBuffer tb(infilename);
+    if (!tb) {
         std::cerr << "Could not open file " << infilename << '\n';
         OK = false;
     } else {
-        // skip first line in file (contains headers)
-        char c = '\0';
-        while (c != '\n' && infile) infile.get(c);
-        if (infile) {
-            ind_type indi;
-            while (infile >> indi) {
-                std::size_t spn = indi.SubPopNum();
-                // check if subpopulation number is valid
-                if (spn < sub_pop.size()) {
-                    if (!sub_pop[spn].Full()) {
-                        if (indi.Alive()) {
-                            sub_pop[spn].Add(indi);
-                            ++n_inds; // count individuals read
-                        }
-                    } else {
-                        std::cerr << "Subpopulation number "
-                                  << spn
-                                  << " is full\n";
-                        OK = false;
-                    }
-                } else {
-                    std::cerr << "Individual\n"
-                              << indi
-                              << "\nhas invalid subpopulation number: "
-                              << spn << '\n';
-                    OK = false;
+        // the lines after the first (which contains headers) are parsed in
+        // parallel, after which the individuals are inserted in file order
+        std::vector<std::vector<ind_type>> inds;
+        std::size_t err_line = 0;
+        if (!ParseIndividuals(tb, inds, err_line)) {
+            std::cerr << "Invalid data on line " << err_line
+                      << " of " << infilename << '\n';
+            OK = false;
+        } else {
+            for (const auto& ci : inds) {
+                for (const auto& indi : ci) {
+                    if (!Insert(indi, n_inds)) OK = false;
                 }
             }
-        } else {
-            std::cerr << "No data to read from " << infilename << "!\n";
-            OK = false;
+            if (n_inds == 0) {
+                std::cerr << "No data to read from " << infilename << "!\n";
+                OK = false;
+            }
+        }
+    }
+    if (n_inds != n) {
+        OK = false;
+    }
+    return OK;
+}
+
+// the file is memory mapped and individuals are assigned directly from the
+// columns of the file
+template <typename SubPop>
+bool MetaPopState<SubPop>::Read_from_BinFile(const std::string& infilename,
+                                             std::size_t n)
+{
+    MappedFile mf(infilename);
+    if (!mf) {
+        std::cerr << "Could not open file " << infilename << '\n';
+        return false;
+    }
+    PopBinView pbv(mf.Data(), mf.Size());
+    if (!pbv.OK()) {
+        std::cerr << infilename << ": " << pbv.Error() << '\n';
+        return false;
+    }
+    return Read_from_Bin(pbv, n);
+}
+
+template <typename SubPop>
+bool MetaPopState<SubPop>::Read_from_Bin(const PopBinView& pbv,
+                                         std::size_t n)
+{
+    if (pbv.ColHeads() != ind_type::ColHeads()) {
+        std::cerr << "Columns in binary population data"
+                  << " do not match individuals\n";
+        return false;
+    }
+    bool OK = true;
+    std::size_t n_inds = 0;
+    std::vector<const double*> cols(ind_type::num_cols);
+    for (std::size_t k = 0; k < cols.size(); ++k) {
+        cols[k] = pbv.Column(k);
+    }
+    ind_type indi;
+    for (std::size_t i = 0; i < pbv.NumRows(); ++i) {
+        for (std::size_t k = 0; k < cols.size(); ++k) {
+            indi.SetCol(k, cols[k][i]);
         }
-        infile.close();
+        if (!Insert(indi, n_inds)) OK = false;
     }
     if (n_inds != n) {
         OK = false;
@@ -675,21 +988,194 @@ bool MetaPopState<SubPop>::Read_from_File(const std::string& infilename,
 }
 
 template <typename SubPop>
-void MetaPopState<SubPop>::Write_to_File(const std::string& outfilename) const
+bool MetaPopState<SubPop>::ColIndices(const std::string& names,
+                                      std::vector<std::size_t>& cols)
 {
-    std::ofstream outfile(outfilename.c_str(), std::ios_base::out);
+    std::vector<std::string> heads = SplitColHeads(ind_type::ColHeads());
+    cols.clear();
+    std::istringstream ist(names);
+    std::string name;
+    while (ist >> name) {
+        std::size_t c = 0;
+        while (c < heads.size() && heads[c] != name) ++c;
+        if (c == heads.size()) {
+            std::cerr << "Unknown column " << name << '\n';
+            return false;
+        }
+        cols.push_back(c);
+    }
+    return true;
+}
+
+// indices of the individuals to write, for each subpopulation
+template <typename SubPop>
+std::vector<std::vector<std::size_t>>
+MetaPopState<SubPop>::OutRows(const PopOutSpec& spec) const
+{
+    std::mt19937 eng(spec.seed);
+    return OutRows(spec, eng);
+}
+
+template <typename SubPop>
+std::vector<std::vector<std::size_t>>
+MetaPopState<SubPop>::OutRows(const PopOutSpec& spec, std::mt19937& eng) const
+{
+    std::vector<std::vector<std::size_t>> rows(sub_pop.size());
+    std::uniform_real_distribution<double> uni(0.0, 1.0);
+    for (std::size_t k = 0; k < sub_pop.size(); ++k) {
+        std::vector<std::size_t>& rk = rows[k];
+        for (std::size_t i = 0; i < sub_pop[k].Iend(); ++i) {
+            if (sub_pop[k][i].Alive()) rk.push_back(i);
+        }
+        if (spec.sample_rate < 1.0) {
+            // selection sampling of m out of the alive individuals
+            std::size_t na = rk.size();
+            std::size_t m = static_cast<std::size_t>(
+                std::floor(spec.sample_rate*na + 0.5));
+            std::size_t sel = 0;
+            for (std::size_t j = 0; j < na && sel < m; ++j) {
+                if ((na - j)*uni(eng) < m - sel) rk[sel++] = rk[j];
+            }
+            rk.resize(sel);
+        }
+    }
+    return rows;
+}
+
+template <typename SubPop>
+bool MetaPopState<SubPop>::Write_to_File(const std::string& outfilename,
+                                         int prec) const
+{
+    PopOutSpec spec;
+    spec.prec = prec;
+    return Write_to_File(outfilename, spec);
+}
+
+template <typename SubPop>
+bool MetaPopState<SubPop>::Write_to_File(const std::string& outfilename,
+                                         const PopOutSpec& spec) const
+{
+    std::vector<std::size_t> cols = spec.cols;
+    if (cols.empty()) {
+        for (std::size_t c = 0; c < ind_type::num_cols; ++c) {
+            cols.push_back(c);
+        }
+    }
+    if (IsPopBinName(outfilename)) {
+        return Write_to_BinFile(outfilename, cols, OutRows(spec));
+    }
+    TextWriter outfile(outfilename, spec.prec);
     if (!outfile) {
         std::cout << "Cannot open " << outfilename << ", cannot save data \n";
+        return false;
     } else {
-        outfile << ind_type::ColHeads() << '\n';
+        std::vector<std::string> heads = SplitColHeads(ind_type::ColHeads());
+        for (std::size_t c = 0; c < cols.size(); ++c) {
+            if (c > 0) outfile.Put('\t');
+            outfile.Put(heads[cols[c]]);
+        }
+        outfile.Put('\n');
+        std::mt19937 eng(spec.seed);
+        Put_Rows(outfile, cols, spec, eng);
+        if (!outfile.Close()) {
+            std::cout << "Failed to write " << outfilename << '\n';
+            return false;
+        }
+    }
+    return true;
+}
+
+template <typename SubPop>
+void MetaPopState<SubPop>::Put_Rows(TextWriter& tw,
+                                    const std::vector<std::size_t>& cols,
+                                    const PopOutSpec& spec,
+                                    std::mt19937& eng) const
+{
+    std::vector<std::vector<std::size_t>> rows = OutRows(spec, eng);
+    for (std::size_t k = 0; k < sub_pop.size(); ++k) {
+        for (std::size_t i : rows[k]) {
+            const ind_type& indi = sub_pop[k][i];
+            for (std::size_t c = 0; c < cols.size(); ++c) {
+                if (c > 0) tw.Put('\t');
+                tw.Put(indi.Col(cols[c]));
+            }
+            tw.Put('\n');
+        }
+    }
+}
+
+template <typename SubPop>
+bool MetaPopState<SubPop>::Write_to_BinFile(const std::string& outfilename,
+    const std::vector<std::size_t>& cols,
+    const std::vector<std::vector<std::size_t>>& rows) const
+{
+    std::FILE* fp = std::fopen(outfilename.c_str(), "wb");
+    if (!fp) {
+        std::cout << "Cannot open " << outfilename << ", cannot save data \n";
+        return false;
+    }
+    bool OK = WriteBin(fp, cols, rows);
+    if (std::fclose(fp) != 0) OK = false;
+    if (!OK) std::cout << "Failed to write " << outfilename << '\n';
+    return OK;
+}
+
+template <typename SubPop>
+bool MetaPopState<SubPop>::Write_to_Bin(std::FILE* fp) const
+{
+    PopOutSpec spec;
+    std::vector<std::size_t> cols;
+    for (std::size_t c = 0; c < ind_type::num_cols; ++c) {
+        cols.push_back(c);
+    }
+    return WriteBin(fp, cols, OutRows(spec));
+}
+
+template <typename SubPop>
+void MetaPopState<SubPop>::Columns(const PopOutSpec& spec,
+    std::vector<std::vector<double>>& data) const
+{
+    std::vector<std::size_t> cols = spec.cols;
+    if (cols.empty()) {
+        for (std::size_t c = 0; c < ind_type::num_cols; ++c) {
+            cols.push_back(c);
+        }
+    }
+    std::vector<std::vector<std::size_t>> rows = OutRows(spec);
+    std::size_t nrows = 0;
+    for (const auto& rk : rows) nrows += rk.size();
+    data.resize(cols.size());
+    for (std::size_t c = 0; c < cols.size(); ++c) {
+        std::vector<double>& v = data[c];
+        v.clear();
+        v.reserve(nrows);
         for (std::size_t k = 0; k < sub_pop.size(); ++k) {
-            for (std::size_t i = 0; i < sub_pop[k].Iend(); ++i) {
-                if (sub_pop[k][i].Alive()) outfile << sub_pop[k][i] << '\n';
+            for (std::size_t i : rows[k]) {
+                v.push_back(sub_pop[k][i].Col(cols[c]));
             }
         }
-        outfile.close();
     }
 }
 
+template <typename SubPop>
+bool MetaPopState<SubPop>::WriteBin(std::FILE* fp,
+    const std::vector<std::size_t>& cols,
+    const std::vector<std::vector<std::size_t>>& rows) const
+{
+    std::vector<std::string> heads = SplitColHeads(ind_type::ColHeads());
+    std::vector<std::string> names;
+    for (std::size_t c : cols) names.push_back(heads[c]);
+    std::vector<std::uint64_t> offs(sub_pop.size() + 1, 0);
+    for (std::size_t k = 0; k < sub_pop.size(); ++k) {
+        offs[k + 1] = offs[k] + rows[k].size();
+    }
+    PopBinWriter pbw(fp, names, offs);
+    for (std::size_t c : cols) {
+        for (std::size_t k = 0; k < sub_pop.size(); ++k) {
+            for (std::size_t i : rows[k]) pbw.Put(sub_pop[k][i].Col(c));
+        }
+    }
+    return pbw.Close();
+}
 
 #endif // METAPOPSTATE_HPP
@@ -0,0 +1,180 @@
+#ifndef MIGRATION_HPP
+#define MIGRATION_HPP
+
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// The EvoProg program runs actor-critic learning simulations
+// Copyright (C) 2019  Olof Leimar
+// See Readme.md for copyright notice
+
+// Structured migration between subpopulations, used by Evo when the
+// migration rate MigRate is below 1 (with MigRate = 1 every individual is
+// moved to a random position in the metapopulation, in Evo::Migrate). In a
+// generation, each subpopulation sends the same number K of its offspring as
+// migrants, where K is m*Ns rounded up or down at random, and migrant r goes
+// to subpopulation n + s_r (modulo nsp), for a shift s_r that is the same
+// for all subpopulations, so that each subpopulation also receives K
+// migrants and keeps its size. For the island model the shifts are uniform
+// over 1 to nsp - 1 (a migrant goes to any other subpopulation with equal
+// probability), and for the stepping-stone model they are +1 or -1 (a
+// migrant goes to a neighbour on a ring of subpopulations). The plan of a
+// generation is drawn from an engine seeded with the generation, so that all
+// threads can compute it without communicating.
+
+//************************** Struct MigPlan *******************************
+
+struct MigPlan {
+// public:
+    std::vector<std::size_t> shifts;    // one per migrant of a subpop
+};
+
+template<typename Eng>
+MigPlan MakeMigPlan(bool stepping, double m, std::size_t nsp, std::size_t Ns,
+                    Eng& eng)
+{
+    MigPlan plan;
+    if (nsp < 2) return plan;
+    std::uniform_real_distribution<double> uni(0.0, 1.0);
+    double mN = m*Ns;
+    std::size_t K = static_cast<std::size_t>(std::floor(mN));
+    if (uni(eng) < mN - K) ++K;
+    if (K > Ns) K = Ns;
+    std::uniform_int_distribution<std::size_t> ush(1, nsp - 1);
+    plan.shifts.resize(K);
+    for (std::size_t& s : plan.shifts) {
+        if (stepping) {
+            s = (uni(eng) < 0.5) ? 1 : nsp - 1;
+        } else {
+            s = ush(eng);
+        }
+    }
+    return plan;
+}
+
+
+//************************* Class SpscQueue *******************************
+
+// A bounded lock-free queue with a single producer thread and a single
+// consumer thread
+
+template<typename T>
+class SpscQueue {
+public:
+    explicit SpscQueue(std::size_t capacity) :
+        buf(capacity + 1), head{0}, tail{0} {}
+    // Returns false if the queue is full
+    bool Push(const T& x)
+    {
+        std::size_t t = tail.load(std::memory_order_relaxed);
+        std::size_t nt = (t + 1 == buf.size()) ? 0 : t + 1;
+        if (nt == head.load(std::memory_order_acquire)) return false;
+        buf[t] = x;
+        tail.store(nt, std::memory_order_release);
+        return true;
+    }
+    // Returns false if the queue is empty
+    bool Pop(T& x)
+    {
+        std::size_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire)) return false;
+        x = buf[h];
+        head.store((h + 1 == buf.size()) ? 0 : h + 1,
+                   std::memory_order_release);
+        return true;
+    }
+private:
+    std::vector<T> buf;
+    alignas(64) std::atomic<std::size_t> head;
+    alignas(64) std::atomic<std::size_t> tail;
+};
+
+
+//************************ Class MigExchange ******************************
+
+// Mailboxes for migrants between threads: one queue for each ordered pair
+// of threads, so that a thread does not wait for other threads, except for
+// the migrants it needs. A message has the generation, and the destination
+// subpopulation and position of the migrant. Messages that a thread has
+// taken from its queues, but that belong to a later generation, or that it
+// sent to itself, are kept in a list for the thread until it asks for them.
+// A thread that finds a queue full takes messages from its own queues while
+// it waits, so that threads cannot block each other.
+
+template<typename Ind>
+class MigExchange {
+public:
+    static_assert(std::is_trivially_copyable<Ind>::value,
+                  "migrants are copied into messages");
+    struct Msg {
+    // public:
+        int gen;
+        std::size_t spn;
+        std::size_t pos;
+        Ind ind;
+    };
+    MigExchange(std::size_t a_num_thrds = 0, std::size_t capacity = 0) :
+        nt{a_num_thrds}, staged(a_num_thrds)
+    {
+        for (std::size_t i = 0; i < nt*nt; ++i) {
+            boxes.emplace_back(new SpscQueue<Msg>(capacity));
+        }
+    }
+    // Send a migrant from thread src to thread dst
+    void Send(std::size_t src, std::size_t dst, const Msg& msg)
+    {
+        if (src == dst) {
+            staged[src].push_back(msg);
+            return;
+        }
+        SpscQueue<Msg>& q = *boxes[src*nt + dst];
+        while (!q.Push(msg)) {
+            Drain(src);
+            std::this_thread::yield();
+        }
+    }
+    // Call f(msg) for the messages of generation gen that have arrived at
+    // thread dst, and return their number
+    template<typename F>
+    std::size_t Receive(std::size_t dst, int gen, F&& f)
+    {
+        Drain(dst);
+        std::vector<Msg>& st = staged[dst];
+        std::size_t k = 0;
+        std::size_t nrec = 0;
+        for (std::size_t i = 0; i < st.size(); ++i) {
+            if (st[i].gen == gen) {
+                f(st[i]);
+                ++nrec;
+            } else {
+                if (k != i) st[k] = st[i];
+                ++k;
+            }
+        }
+        st.resize(k);
+        return nrec;
+    }
+private:
+    // move messages from the queues of thread dst to its list
+    void Drain(std::size_t dst)
+    {
+        Msg msg;
+        for (std::size_t src = 0; src < nt; ++src) {
+            if (src == dst) continue;
+            SpscQueue<Msg>& q = *boxes[src*nt + dst];
+            while (q.Pop(msg)) staged[dst].push_back(msg);
+        }
+    }
+    std::size_t nt;
+    std::vector<std::unique_ptr<SpscQueue<Msg>>> boxes;
+    std::vector<std::vector<Msg>> staged;
+};
+
+#endif // MIGRATION_HPP
@@ -0,0 +1,137 @@
+#ifndef PAYOFF_HPP
+#define PAYOFF_HPP
+
+#include <cmath>
+#include <string>
+
+// The EvoProg program runs actor-critic learning simulations
+// Copyright (C) 2019  Olof Leimar
+// See Readme.md for copyright notice
+
+// Payoff models for the public goods game in ActCritGroup. A model is a
+// class that is used as a template parameter of ActCritGroup, so that its
+// functions are inlined in the learning loop, without virtual calls. A model
+// has a constructor from PayoffPars, and two functions:
+//   Benefit(av_a): the benefit to each group member, from the mean action
+//   (investment) av_a in the group
+//   Cost(a, x): the cost to an individual of its action a, where x is the
+//   perceived quality p (for the reward used in learning) or the real
+//   quality q (for the payoff)
+// and a static member Name, which is the value of PayoffModel in the input
+// file that selects the model. The models are listed in PayoffModels, at the
+// end of this file.
+
+//*************************** Struct PayoffPars **************************
+
+// Parameters of payoff models (each model uses some of them)
+
+struct PayoffPars {
+// public:
+    double B0 = 0.0;    // benefit at zero investment
+    double B1 = 0.0;    // linear benefit
+    double B2 = 0.0;    // quadratic benefit
+    double K1 = 0.0;    // linear cost
+    double K11 = 0.0;   // quadratic (or nonlinear) cost
+    double K12 = 0.0;   // cost depending on quality
+    double Athr = 1.0;  // threshold of mean investment for the bonus
+    double Bthr = 0.0;  // bonus when the threshold is reached
+    double Kexp = 2.0;  // exponent of nonlinear cost
+};
+
+
+//*************************** Struct QuadPayoff **************************
+
+// Quadratic benefit and cost (the model of the paper)
+
+struct QuadPayoff {
+// public:
+    static constexpr const char* Name = "quadratic";
+    explicit QuadPayoff(const PayoffPars& pp) :
+        B0{pp.B0}, B1{pp.B1}, B2{pp.B2},
+        K1{pp.K1}, K11{pp.K11}, K12{pp.K12} {}
+    double Benefit(double av_a) const
+    { return B0 + B1*av_a + 0.5*B2*av_a*av_a; }
+    double Cost(double a, double x) const
+    { return (K1 + 0.5*K11*a + K12*x)*a; }
+    double B0, B1, B2, K1, K11, K12;
+};
+
+
+//************************** Struct ThreshPayoff *************************
+
+// Threshold public good: quadratic benefit and cost, and a bonus Bthr to
+// each member when the mean investment in the group reaches Athr
+
+struct ThreshPayoff {
+// public:
+    static constexpr const char* Name = "threshold";
+    explicit ThreshPayoff(const PayoffPars& pp) :
+        quad{pp}, Athr{pp.Athr}, Bthr{pp.Bthr} {}
+    double Benefit(double av_a) const
+    { return quad.Benefit(av_a) + (av_a >= Athr ? Bthr : 0.0); }
+    double Cost(double a, double x) const
+    { return quad.Cost(a, x); }
+    QuadPayoff quad;
+    double Athr, Bthr;
+};
+
+
+//************************** Struct PowCostPayoff ************************
+
+// Quadratic benefit and a cost that increases as a power Kexp of the size of
+// the investment, (K1 + K12*x)*a + K11*|a|^Kexp/Kexp, which is the quadratic
+// cost for Kexp = 2
+
+struct PowCostPayoff {
+// public:
+    static constexpr const char* Name = "powcost";
+    explicit PowCostPayoff(const PayoffPars& pp) :
+        quad{pp}, K1{pp.K1}, K11{pp.K11}, K12{pp.K12}, Kexp{pp.Kexp} {}
+    double Benefit(double av_a) const
+    { return quad.Benefit(av_a); }
+    double Cost(double a, double x) const
+    { return (K1 + K12*x)*a + K11*std::pow(std::abs(a), Kexp)/Kexp; }
+    QuadPayoff quad;
+    double K1, K11, K12, Kexp;
+};
+
+
+//************************* Class PayoffRegistry *************************
+
+// The registry of payoff models, which selects a model from its name; for a
+// model type P, Dispatch calls f(PayoffTag<P>()), and the model is then a
+// compile-time type in f (typename decltype(tag)::type)
+
+template<typename P>
+struct PayoffTag {
+// public:
+    using type = P;
+};
+
+template<typename... Ps>
+class PayoffRegistry {
+public:
+    // Whether name is the name of a model
+    static bool Contains(const std::string& name)
+    { return ((name == Ps::Name) || ...); }
+    // Names of the models, separated by spaces
+    static std::string Names()
+    {
+        std::string names;
+        ((names += (names.empty() ? "" : " ") + std::string(Ps::Name)), ...);
+        return names;
+    }
+    // Call f with the tag of the model with the given name; returns false if
+    // there is no such model
+    template<typename F>
+    static bool Dispatch(const std::string& name, F&& f)
+    { return ((name == Ps::Name ? (f(PayoffTag<Ps>()), true) : false) || ...); }
+    // Call f with the tag of each model
+    template<typename F>
+    static void ForEach(F&& f) { (f(PayoffTag<Ps>()), ...); }
+};
+
+// The available models; the first is the default
+using PayoffModels = PayoffRegistry<QuadPayoff, ThreshPayoff, PowCostPayoff>;
+
+#endif // PAYOFF_HPP
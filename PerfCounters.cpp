@@ -0,0 +1,137 @@
+#include "PerfCounters.hpp"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#endif
+
+// The EvoProg program runs actor-critic learning simulations
+// Copyright (C) 2019  Olof Leimar
+// See Readme.md for copyright notice
+
+namespace {
+
+#ifdef __linux__
+struct EventSpec {
+// public:
+    std::uint32_t type;
+    std::uint64_t config;
+};
+
+// perf_event_open type and config, in the order of PerfEvent
+const std::array<EventSpec, num_perf_events> EventSpecs = {{
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK}}};
+
+// open a counter for the calling thread, on any CPU, counting only user
+// space (which is permitted with the default perf_event_paranoid setting);
+// the counters are read together, through the group leader
+int OpenEvent(const EventSpec& es, int group_fd)
+{
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = es.type;
+    attr.config = es.config;
+    attr.read_format = PERF_FORMAT_GROUP;
+    attr.disabled = (group_fd < 0) ? 1 : 0;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return static_cast<int>(
+        syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0));
+}
+#endif
+
+} // namespace
+
+
+//************************* Class PerfCounters ***************************
+
+PerfCounters::PerfCounters() :
+    leader{-1},
+    num_open{0},
+    last{}
+{
+    fds.fill(-1);
+    pos.fill(-1);
+}
+
+bool PerfCounters::Open(std::size_t num_phases)
+{
+    Close();
+    counts.assign(num_phases, counts_type{});
+#ifdef __linux__
+    for (std::size_t ev = 0; ev < num_perf_events; ++ev) {
+        int fd = OpenEvent(EventSpecs[ev], leader);
+        if (fd < 0) {
+            if (!err.empty()) err += "; ";
+            err += std::string(PerfEventNames[ev]) + ": "
+                + std::strerror(errno);
+            continue;
+        }
+        if (leader < 0) leader = fd;
+        fds[ev] = fd;
+        pos[ev] = num_open++;
+    }
+    if (leader >= 0) {
+        ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+#else
+    err = "performance counters are only available on Linux";
+#endif
+    return Active();
+}
+
+void PerfCounters::Close()
+{
+#ifdef __linux__
+    for (int& fd : fds) {
+        if (fd >= 0) close(fd);
+        fd = -1;
+    }
+#endif
+    pos.fill(-1);
+    leader = -1;
+    num_open = 0;
+}
+
+void PerfCounters::Start()
+{
+    if (Active()) Read(last);
+}
+
+void PerfCounters::Lap(std::size_t ph)
+{
+    counts_type now;
+    if (!Active() || !Read(now)) return;
+    for (std::size_t ev = 0; ev < num_perf_events; ++ev) {
+        counts[ph][ev] += now[ev] - last[ev];
+    }
+    last = now;
+}
+
+// read all counters of the group at once
+bool PerfCounters::Read(counts_type& v) const
+{
+#ifdef __linux__
+    // the data are the number of counters followed by their values
+    count_type buf[1 + num_perf_events];
+    ssize_t sz = (1 + num_open)*sizeof(count_type);
+    if (read(leader, buf, sz) != sz) return false;
+    for (std::size_t ev = 0; ev < num_perf_events; ++ev) {
+        v[ev] = (pos[ev] >= 0) ? buf[1 + pos[ev]] : 0;
+    }
+    return true;
+#else
+    v.fill(0);
+    return false;
+#endif
+}
@@ -0,0 +1,70 @@
+#ifndef PERFCOUNTERS_HPP
+#define PERFCOUNTERS_HPP
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// The EvoProg program runs actor-critic learning simulations
+// Copyright (C) 2019  Olof Leimar
+// See Readme.md for copyright notice
+
+// This unit reads hardware performance counters (cycles, instructions, cache
+// misses, branch misses), and the CPU time of a thread, using the Linux
+// perf_event_open system call. The counters of a thread are accumulated for a
+// number of phases, in the same way as the times in PhaseClock (see
+// RunProfile.hpp). Counters that cannot be opened (for instance on a virtual
+// machine without hardware counters, when perf_event_paranoid does not
+// permit it, or on other systems than Linux) are marked as not available, and
+// the others are still used.
+
+enum PerfEvent { pe_cycles, pe_instructions, pe_cache_misses,
+                 pe_branch_misses, pe_task_clock, num_perf_events };
+
+// Names of events, in the order of PerfEvent
+const std::array<const char*, num_perf_events> PerfEventNames =
+    {{"cycles", "instructions", "cache_misses", "branch_misses",
+      "task_clock_ns"}};
+
+
+//************************* Class PerfCounters ***************************
+
+// Counters for the calling thread, which should call Open(), Start() and
+// Lap(); the class is aligned to a cache line, so that the counters of
+// different threads can be kept in a vector
+
+class alignas(64) PerfCounters {
+public:
+    using count_type = std::uint64_t;
+    using counts_type = std::array<count_type, num_perf_events>;
+    PerfCounters();
+    ~PerfCounters() { Close(); }
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+    // Open the counters for the calling thread, to be accumulated for
+    // num_phases phases; returns false if no counter could be opened
+    bool Open(std::size_t num_phases);
+    void Close();
+    bool Active() const { return leader >= 0; }
+    bool Available(PerfEvent ev) const { return pos[ev] >= 0; }
+    // Description of why counters are not available
+    const std::string& Error() const { return err; }
+    // Start counting (the first lap starts now)
+    void Start();
+    // Attribute the counts since the previous lap to phase ph
+    void Lap(std::size_t ph);
+    count_type Count(std::size_t ph, PerfEvent ev) const
+    { return counts[ph][ev]; }
+private:
+    bool Read(counts_type& v) const;
+    int leader;                             // file descriptor of group leader
+    std::array<int, num_perf_events> fds;
+    std::array<int, num_perf_events> pos;   // position in group (-1: none)
+    int num_open;
+    std::string err;
+    counts_type last;
+    std::vector<counts_type> counts;
+};
+
+#endif // PERFCOUNTERS_HPP
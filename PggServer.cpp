@@ -0,0 +1,214 @@
+#include "PggServer.hpp"
+#include "Utils.hpp"
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// The EvoProg program runs actor-critic learning simulations
+// Copyright (C) 2019  Olof Leimar
+// See Readme.md for copyright notice
+
+namespace {
+
+// read a positive count from is
+bool ReadCount(std::istream& is, int& n)
+{
+    return (is >> n) && n > 0;
+}
+
+// the population, one vector per column
+std::vector<std::vector<double>> GetCols(const pgg_sim* sim)
+{
+    std::size_t n = pgg_num_inds(sim);
+    std::vector<std::vector<double>> cols(pgg_num_cols());
+    for (int k = 0; k < pgg_num_cols(); ++k) {
+        cols[k].resize(n);
+        pgg_get_col(sim, k, cols[k].data(), n);
+    }
+    return cols;
+}
+
+// carry out the command in line, putting the reply in os; returns false if
+// the server should stop
+bool Command(pgg_sim* sim, const std::string& line, std::ostream& os)
+{
+    std::istringstream is(line);
+    std::string cmd;
+    if (!(is >> cmd) || cmd[0] == '#') return true;
+    os << std::setprecision(std::numeric_limits<double>::max_digits10);
+    int n = 0;
+    if (cmd == "gens") {
+        if (!ReadCount(is, n)) {
+            os << "error gens needs a positive number\n";
+            return true;
+        }
+        int r = pgg_step(sim, n);
+        if (r < 0) {
+            os << "error cannot run generations\n";
+        } else {
+            os << "ok gens " << r << " gen " << pgg_generation(sim) << '\n';
+        }
+    } else if (cmd == "steps") {
+        if (!ReadCount(is, n)) {
+            os << "error steps needs a positive number\n";
+            return true;
+        }
+        if (pgg_learn(sim, n) < 0) {
+            os << "error cannot run steps\n";
+        } else {
+            os << "ok steps " << n << '\n';
+        }
+    } else if (cmd == "stats") {
+        std::vector<std::vector<double>> cols = GetCols(sim);
+        os << "col\tmean\tsd\n";
+        for (std::size_t k = 0; k < cols.size(); ++k) {
+            const std::vector<double>& c = cols[k];
+            double sum = 0.0;
+            for (double x : c) sum += x;
+            double mean = c.empty() ? 0.0 : sum/c.size();
+            double ss = 0.0;
+            for (double x : c) ss += (x - mean)*(x - mean);
+            double sd = (c.size() > 1) ? std::sqrt(ss/(c.size() - 1)) : 0.0;
+            os << pgg_col_name(k) << '\t' << mean << '\t' << sd << '\n';
+        }
+        os << "ok stats " << cols.size() << '\n';
+    } else if (cmd == "dump") {
+        std::string filename;
+        if (is >> filename) {
+            if (pgg_write_pop(sim, filename.c_str()) != 0) {
+                os << "error cannot write " << filename << '\n';
+            } else {
+                os << "ok dump " << filename << '\n';
+            }
+            return true;
+        }
+        std::vector<std::vector<double>> cols = GetCols(sim);
+        for (int k = 0; k < pgg_num_cols(); ++k) {
+            if (k > 0) os << '\t';
+            os << pgg_col_name(k);
+        }
+        os << '\n';
+        std::size_t ni = pgg_num_inds(sim);
+        for (std::size_t i = 0; i < ni; ++i) {
+            for (std::size_t k = 0; k < cols.size(); ++k) {
+                if (k > 0) os << '\t';
+                os << cols[k][i];
+            }
+            os << '\n';
+        }
+        os << "ok dump " << ni << '\n';
+    } else if (cmd == "set") {
+        std::string name;
+        std::string value;
+        is >> name;
+        std::getline(is >> std::ws, value);
+        if (name.empty() || value.empty()) {
+            os << "error set needs a name and a value\n";
+        } else if (pgg_set_param(sim, name.c_str(), value.c_str()) != 0) {
+            os << "error cannot set " << name << '\n';
+        } else {
+            os << "ok set " << name << '\n';
+        }
+    } else if (cmd == "info") {
+        os << "ok gen " << pgg_generation(sim) << " numgen "
+           << pgg_num_generations(sim) << " inds " << pgg_num_inds(sim)
+           << '\n';
+    } else if (cmd == "quit") {
+        os << "ok quit\n";
+        return false;
+    } else {
+        os << "error unknown command " << cmd << '\n';
+    }
+    return true;
+}
+
+} // namespace
+
+int ServeStdio(pgg_sim* sim, std::ostream& out)
+{
+    std::string line;
+    bool go_on = true;
+    while (go_on && std::getline(std::cin, line)) {
+        std::ostringstream reply;
+        go_on = Command(sim, line, reply);
+        out << reply.str() << std::flush;
+    }
+    return 0;
+}
+
+int ServeSocket(pgg_sim* sim, const std::string& socket_path)
+{
+    sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (socket_path.empty() || socket_path.size() >= sizeof(addr.sun_path)) {
+        std::cout << "Invalid socket path " << socket_path << '\n';
+        return -1;
+    }
+    std::strcpy(addr.sun_path, socket_path.c_str());
+    // a socket left by an earlier server is removed, but nothing else (the
+    // path could be an input file given by mistake)
+    struct stat sb;
+    if (lstat(socket_path.c_str(), &sb) == 0) {
+        if (!S_ISSOCK(sb.st_mode)) {
+            std::cout << socket_path << " exists and is not a socket\n";
+            return -1;
+        }
+        unlink(socket_path.c_str());
+    }
+    int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd < 0) {
+        std::cout << "socket: " << std::strerror(errno) << '\n';
+        return -1;
+    }
+    if (bind(listen_fd, reinterpret_cast<sockaddr*>(&addr),
+             sizeof(addr)) < 0 || listen(listen_fd, 4) < 0) {
+        std::cout << "Cannot listen on " << socket_path << ": "
+                  << std::strerror(errno) << '\n';
+        close(listen_fd);
+        return -1;
+    }
+    std::cout << "Serving on " << socket_path << std::endl;
+    bool go_on = true;
+    while (go_on) {
+        int fd = accept(listen_fd, nullptr, nullptr);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            std::cout << "accept: " << std::strerror(errno) << '\n';
+            break;
+        }
+        // serve this client until it closes the connection or quits
+        std::string pending;
+        char buf[4096];
+        bool open = true;
+        while (go_on && open) {
+            ssize_t nr = recv(fd, buf, sizeof(buf), 0);
+            if (nr < 0 && errno == EINTR) continue;
+            if (nr <= 0) break;
+            pending.append(buf, nr);
+            std::size_t pos;
+            while (go_on && open &&
+                   (pos = pending.find('\n')) != std::string::npos) {
+                std::string line = pending.substr(0, pos);
+                pending.erase(0, pos + 1);
+                if (!line.empty() && line.back() == '\r') line.pop_back();
+                std::ostringstream reply;
+                go_on = Command(sim, line, reply);
+                open = SendAll(fd, reply.str());
+            }
+        }
+        close(fd);
+    }
+    close(listen_fd);
+    unlink(socket_path.c_str());
+    return 0;
+}
@@ -0,0 +1,35 @@
+#ifndef PGGSERVER_HPP
+#define PGGSERVER_HPP
+
+#include "PggSim.h"
+#include <ostream>
+#include <string>
+
+// The EvoProg program runs actor-critic learning simulations
+// Copyright (C) 2019  Olof Leimar
+// See Readme.md for copyright notice
+
+// Server mode of EvoProg.exe (option --serve): the simulation is kept in
+// memory, with its population and random number engines, and is driven by
+// commands, one per line, so that scripts can run many short steps without
+// starting the program and reading and writing population files each time.
+// The commands are read from standard input, with replies on standard
+// output (messages from the simulation then go to standard error), or from
+// clients of a Unix-domain socket, one client at a time. The commands are
+//   gens N        run N generations
+//   steps N       run N time steps of learning in the current groups
+//   stats         mean and SD of each column of the population
+//   dump [FILE]   the population as text rows, or written to FILE
+//   set NAME VAL  change a parameter (as in the input file)
+//   info          generations run and in total, and number of individuals
+//   quit          stop the server
+// and the reply to a command is a number of lines of data (for stats and
+// dump) and then a line starting with "ok" or "error".
+
+// Serve commands from standard input, with replies on out (the caller
+// sends std::cout to standard error), or from the socket at socket_path,
+// until quit or end of input; returns 0 if the server could be started
+int ServeStdio(pgg_sim* sim, std::ostream& out);
+int ServeSocket(pgg_sim* sim, const std::string& socket_path);
+
+#endif // PGGSERVER_HPP
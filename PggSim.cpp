@@ -0,0 +1,181 @@
+#include "PggSim.h"
+#include "EvoCode.hpp"
+#include "PopBinFile.hpp"
+#include <exception>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+// The EvoProg program runs actor-critic learning simulations
+// Copyright (C) 2019  Olof Leimar
+// See Readme.md for copyright notice
+
+struct pgg_sim {
+// public:
+    explicit pgg_sim(const EvoInpData& eid) : evo(eid) {}
+    Evo evo;
+};
+
+namespace {
+
+using ind_type = Evo::ind_type;
+
+const std::vector<std::string>& ColNames()
+{
+    static const std::vector<std::string> names =
+        SplitColHeads(ind_type::ColHeads());
+    return names;
+}
+
+// Return f(), or fail if f throws; exceptions are reported, and must not
+// reach the callers of the C API
+template<typename F, typename R>
+R Guard(F&& f, R fail)
+{
+    try {
+        return f();
+    } catch (const std::bad_alloc&) {
+        std::cout << "Not enough memory for the simulation\n";
+    } catch (const std::exception& e) {
+        std::cout << "The simulation failed: " << e.what() << '\n';
+    } catch (...) {
+        std::cout << "The simulation failed\n";
+    }
+    return fail;
+}
+
+pgg_sim* Create(EvoInpData& eid, int flags)
+{
+    if (!eid.OK) return nullptr;
+    if (flags & PGG_RESUME) eid.Resume = true;
+    // stop at once if the run would not fit in memory
+    if (!Evo::CheckMem(eid)) return nullptr;
+    return new pgg_sim(eid);
+}
+
+} // namespace
+
+int pgg_api_version(void)
+{
+    return PGG_API_VERSION;
+}
+
+pgg_sim* pgg_create_from_file(const char* inp_name, int flags)
+{
+    if (!inp_name) return nullptr;
+    return Guard([=]() {
+        EvoInpData eid(inp_name);
+        return Create(eid, flags);
+    }, static_cast<pgg_sim*>(nullptr));
+}
+
+pgg_sim* pgg_create_from_text(const char* inp_text, const char* name,
+                              int flags)
+{
+    if (!inp_text) return nullptr;
+    return Guard([=]() {
+        EvoInpData eid(inp_text, name ? name : "");
+        return Create(eid, flags);
+    }, static_cast<pgg_sim*>(nullptr));
+}
+
+void pgg_destroy(pgg_sim* sim)
+{
+    Guard([=]() {
+        delete sim;
+        return 0;
+    }, -1);
+}
+
+int pgg_run(pgg_sim* sim)
+{
+    if (!sim) return -1;
+    return Guard([=]() {
+        sim->evo.Run();
+        return 0;
+    }, -1);
+}
+
+int pgg_step(pgg_sim* sim, int num_gens)
+{
+    if (!sim) return -1;
+    return Guard([=]() { return sim->evo.Step(num_gens); }, -1);
+}
+
+int pgg_learn(pgg_sim* sim, int num_steps)
+{
+    if (!sim) return -1;
+    return Guard([=]() { return sim->evo.Learn(num_steps); }, -1);
+}
+
+int pgg_set_param(pgg_sim* sim, const char* name, const char* value)
+{
+    if (!sim || !name || !value) return -1;
+    return Guard([=]() {
+        return sim->evo.SetParam(name, value) ? 0 : -1;
+    }, -1);
+}
+
+int pgg_write_pop(pgg_sim* sim, const char* filename)
+{
+    if (!sim || !filename || !*filename) return -1;
+    return Guard([=]() {
+        return sim->evo.SavePop(filename) ? 0 : -1;
+    }, -1);
+}
+
+int pgg_generation(const pgg_sim* sim)
+{
+    return sim ? sim->evo.Generation() : 0;
+}
+
+int pgg_num_generations(const pgg_sim* sim)
+{
+    return sim ? sim->evo.NumGenerations() : 0;
+}
+
+size_t pgg_num_inds(const pgg_sim* sim)
+{
+    if (!sim) return 0;
+    const Evo::metapop_type& pop = sim->evo.Population();
+    std::size_t n = 0;
+    for (std::size_t spn = 0; spn < pop.NumPops(); ++spn) {
+        n += pop[spn].size();
+    }
+    return n;
+}
+
+int pgg_num_cols(void)
+{
+    return Guard([]() { return static_cast<int>(ColNames().size()); }, 0);
+}
+
+const char* pgg_col_name(int k)
+{
+    if (k < 0 || k >= pgg_num_cols()) return nullptr;
+    return ColNames()[k].c_str();
+}
+
+int pgg_col_index(const char* name)
+{
+    if (!name) return -1;
+    for (int k = 0; k < pgg_num_cols(); ++k) {
+        if (ColNames()[k] == name) return k;
+    }
+    return -1;
+}
+
+size_t pgg_get_col(const pgg_sim* sim, int k, double* buf, size_t len)
+{
+    if (!sim || !buf || k < 0 || k >= pgg_num_cols()) return 0;
+    const Evo::metapop_type& pop = sim->evo.Population();
+    std::size_t n = 0;
+    for (std::size_t spn = 0; spn < pop.NumPops(); ++spn) {
+        const Evo::subpop_type& sp = pop[spn];
+        for (std::size_t i = 0; i < sp.size() && n < len; ++i) {
+            buf[n++] = sp[i].Col(k);
+        }
+    }
+    return n;
+}
@@ -0,0 +1,101 @@
+#ifndef PGGSIM_H
+#define PGGSIM_H
+
+#include <stddef.h>
+
+/* The EvoProg program runs actor-critic learning simulations
+ * Copyright (C) 2019  Olof Leimar
+ * See Readme.md for copyright notice
+ */
+
+/************************** C API of libpggsim *****************************
+ *
+ * The simulations can be used from other programs (for instance R, through
+ * .C or Rcpp, or Python, through ctypes) by linking to libpggsim (built with
+ * "make lib"). A simulation is created from the parameters of an input file,
+ * given either as a file name or as the contents of an input file held in
+ * memory, and it can then be run to the end, or in steps of a number of
+ * generations, and the columns of the population (as in text output, e.g.
+ * w0, theta0 and d) can be copied into arrays of the caller. EvoProg.exe
+ * itself only uses these functions.
+ *
+ * The functions do not throw exceptions: an exception in the simulation is
+ * reported as a message, and the function returns an error value (NULL or
+ * -1, or 0 for counts). A simulation should only be used by one thread at
+ * a time (a simulation runs with its own threads). Messages are written to
+ * standard output, as for EvoProg.exe.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Version of the API, which changes when functions are added */
+#define PGG_API_VERSION 2
+
+/* Flags for creating a simulation: continue from the checkpoint given in
+ * the input parameters (as option --resume of EvoProg.exe) */
+#define PGG_RESUME 1
+
+typedef struct pgg_sim pgg_sim;
+
+int pgg_api_version(void);
+
+/* Create a simulation from an input file, or from the contents of an input
+ * file (name is used in reports and checkpoints, and can be NULL); returns
+ * NULL if the input is not valid, or if the predicted memory of the run
+ * exceeds MemLimit (or the physical memory) */
+pgg_sim* pgg_create_from_file(const char* inp_name, int flags);
+pgg_sim* pgg_create_from_text(const char* inp_text, const char* name,
+                              int flags);
+void pgg_destroy(pgg_sim* sim);
+
+/* Run the remaining generations (or the invasion analysis, or the run with
+ * a population store) and write the output; returns 0 if the run could be
+ * done */
+int pgg_run(pgg_sim* sim);
+
+/* Run at most num_gens generations, and return the number run, or -1 if the
+ * simulation cannot be run in steps (for RunMode = invasion, or with a
+ * population store); the output is written after the last generation */
+int pgg_step(pgg_sim* sim, int num_gens);
+
+/* Run num_steps more time steps of learning in the groups of the current
+ * population, without new qualities or reproduction (as a run with numgen =
+ * 1 and cont_gen = 1 that reads the population written by the previous
+ * run); returns num_steps, or -1 as for pgg_step */
+int pgg_learn(pgg_sim* sim, int num_steps);
+
+/* Change a parameter, with its name and value as in an input file, for the
+ * following steps (learning and payoff parameters, T, numgen, mutation and
+ * recombination, MigRate, MigModel, OutName and StatName; numgen must be
+ * above the generations run, and cannot be changed after the last
+ * generation); returns 0 if the parameter was changed */
+int pgg_set_param(pgg_sim* sim, const char* name, const char* value);
+
+/* Write the current population to a file, as text or binary (depending on
+ * the name, as for OutName); returns 0 if the population was written */
+int pgg_write_pop(pgg_sim* sim, const char* filename);
+
+/* Generations run so far, and in total */
+int pgg_generation(const pgg_sim* sim);
+int pgg_num_generations(const pgg_sim* sim);
+
+/* The population: between steps it is the population at the start of the
+ * next generation (offspring that have not yet learned), and after the last
+ * generation it is the final population */
+size_t pgg_num_inds(const pgg_sim* sim);
+int pgg_num_cols(void);
+/* Name of column k, or NULL if there is no such column */
+const char* pgg_col_name(int k);
+/* Index of the column with name, or -1 if there is no such column */
+int pgg_col_index(const char* name);
+/* Copy column k of at most len individuals, in the order of the population,
+ * to buf, and return the number copied */
+size_t pgg_get_col(const pgg_sim* sim, int k, double* buf, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PGGSIM_H */
@@ -68,6 +68,11 @@ struct Phenotype {
     void Assign(const gen_type& g, bool a_female);
     void Set_q(double a_q) { q = a_q; p = q + d; }
     bool Female() const { return female; }
+    // column access, in the same order as ColHeads(); integer and bool
+    // members are converted to and from double
+    static const std::size_t num_cols = 16;
+    double Col(std::size_t k) const;
+    void SetCol(std::size_t k, double v);
     static std::string ColHeads();
     // public data members
     double w0;      // value of expected reward w at start of generation
@@ -112,6 +117,52 @@ void Phenotype<GenType>::Assign(const gen_type& g, bool a_female)
     female = a_female;
 }
 
+template<typename GenType>
+double Phenotype<GenType>::Col(std::size_t k) const
+{
+    switch (k) {
+    case 0: return w0;
+    case 1: return theta0;
+    case 2: return d;
+    case 3: return q;
+    case 4: return p;
+    case 5: return w;
+    case 6: return R;
+    case 7: return theta;
+    case 8: return a;
+    case 9: return payoff;
+    case 10: return delta;
+    case 11: return elig;
+    case 12: return ztheta;
+    case 13: return gnum;
+    case 14: return inum;
+    default: return female;
+    }
+}
+
+template<typename GenType>
+void Phenotype<GenType>::SetCol(std::size_t k, double v)
+{
+    switch (k) {
+    case 0: w0 = v; break;
+    case 1: theta0 = v; break;
+    case 2: d = v; break;
+    case 3: q = v; break;
+    case 4: p = v; break;
+    case 5: w = v; break;
+    case 6: R = v; break;
+    case 7: theta = v; break;
+    case 8: a = v; break;
+    case 9: payoff = v; break;
+    case 10: delta = v; break;
+    case 11: elig = v; break;
+    case 12: ztheta = v; break;
+    case 13: gnum = static_cast<int>(v); break;
+    case 14: inum = static_cast<int>(v); break;
+    default: female = (v != 0.0); break;
+    }
+}
+
 template<typename GenType>
 std::string Phenotype<GenType>::ColHeads()
 {
@@ -0,0 +1,320 @@
+#include "PopBinFile.hpp"
+#include "TextWriter.hpp"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// The EvoProg program runs actor-critic learning simulations
+// Copyright (C) 2019  Olof Leimar
+// See Readme.md for copyright notice
+
+namespace {
+
+const char Magic[8] = {'P', 'G', 'G', 'P', 'O', 'P', 'B', '\0'};
+const std::uint32_t ByteOrderTag = 0x01020304;
+const std::size_t HeaderSize = 56;
+const std::size_t DataAlign = 64;
+// largest number of subpopulations in a converted text file, which bounds
+// the table of offsets allocated from the SubPop column
+const std::size_t MaxSubPops = std::size_t(1) << 24;
+
+std::size_t RoundUp(std::size_t n, std::size_t m)
+{
+    return ((n + m - 1)/m)*m;
+}
+
+} // namespace
+
+bool IsPopBinName(const std::string& filename)
+{
+    std::size_t n = std::strlen(PopBinExt);
+    return filename.size() > n &&
+        filename.compare(filename.size() - n, n, PopBinExt) == 0;
+}
+
+std::vector<std::string> SplitColHeads(const std::string& col_heads)
+{
+    std::vector<std::string> names;
+    std::size_t pos = 0;
+    while (pos <= col_heads.size()) {
+        std::size_t tab = col_heads.find('\t', pos);
+        if (tab == std::string::npos) tab = col_heads.size();
+        names.push_back(col_heads.substr(pos, tab - pos));
+        pos = tab + 1;
+    }
+    return names;
+}
+
+
+//************************** Class MappedFile ****************************
+
+MappedFile::MappedFile(const std::string& filename) :
+    data{nullptr},
+    size{0}
+{
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) return;
+    struct stat sb;
+    if (fstat(fd, &sb) == 0 && sb.st_size > 0) {
+        void* p = mmap(nullptr, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p != MAP_FAILED) {
+            data = static_cast<const char*>(p);
+            size = sb.st_size;
+        }
+    }
+    close(fd);
+}
+
+MappedFile::~MappedFile()
+{
+    if (data) munmap(const_cast<char*>(data), size);
+}
+
+
+//************************** Class PopBinView ****************************
+
+PopBinView::PopBinView(const char* a_data, std::size_t a_size) :
+    ok{true},
+    ncols{0},
+    nrows{0},
+    npops{0},
+    offs{nullptr},
+    cols{nullptr}
+{
+    if (!a_data || a_size < HeaderSize ||
+        std::memcmp(a_data, Magic, sizeof(Magic)) != 0) {
+        Fail("not a binary population file");
+        return;
+    }
+    std::uint32_t version = 0;
+    std::uint32_t tag = 0;
+    std::memcpy(&version, a_data + 8, 4);
+    std::memcpy(&tag, a_data + 12, 4);
+    if (tag != ByteOrderTag) {
+        Fail("byte order of file does not match this computer");
+        return;
+    }
+    if (version != PopBinVersion) {
+        Fail("unsupported format version");
+        return;
+    }
+    std::uint64_t hd[5];
+    std::memcpy(hd, a_data + 16, sizeof(hd));
+    ncols = hd[0];
+    nrows = hd[1];
+    npops = hd[2];
+    std::uint64_t names_size = hd[3];
+    std::uint64_t data_off = hd[4];
+    // each term is checked against the size before it is used, so that
+    // the checks cannot overflow for a corrupt header
+    if (names_size % 8 != 0 || data_off % 8 != 0 ||
+        names_size > a_size - HeaderSize || data_off > a_size) {
+        Fail("file is truncated or has an invalid header");
+        return;
+    }
+    std::size_t offs_pos = HeaderSize + names_size;
+    if (offs_pos > data_off || npops >= (data_off - offs_pos)/8 ||
+        (ncols > 0 && nrows > (a_size - data_off)/8/ncols)) {
+        Fail("file is truncated or has an invalid header");
+        return;
+    }
+    const char* nb = a_data + HeaderSize;
+    names = SplitColHeads(std::string(nb, strnlen(nb, names_size)));
+    if (names.size() != ncols) {
+        Fail("number of column names does not match number of columns");
+        return;
+    }
+    offs = reinterpret_cast<const std::uint64_t*>(a_data + offs_pos);
+    for (std::size_t k = 0; k < npops; ++k) {
+        if (offs[k] > offs[k + 1]) {
+            Fail("invalid subpopulation offsets");
+            return;
+        }
+    }
+    if (offs[0] != 0 || offs[npops] != nrows) {
+        Fail("invalid subpopulation offsets");
+        return;
+    }
+    cols = reinterpret_cast<const double*>(a_data + data_off);
+}
+
+std::string PopBinView::ColHeads() const
+{
+    std::string col_hds;
+    for (std::size_t k = 0; k < names.size(); ++k) {
+        if (k > 0) col_hds += "\t";
+        col_hds += names[k];
+    }
+    return col_hds;
+}
+
+std::size_t PopBinView::ColIndex(const std::string& name) const
+{
+    auto it = std::find(names.begin(), names.end(), name);
+    return it - names.begin();
+}
+
+
+//************************* Class PopBinWriter ***************************
+
+PopBinWriter::PopBinWriter(std::FILE* a_fp,
+                           const std::vector<std::string>& col_names,
+                           const std::vector<std::uint64_t>& pop_offsets) :
+    fp{a_fp},
+    buf(8192),
+    nbuf{0},
+    nput{0},
+    nexpect{0},
+    ok{true}
+{
+    std::string nb;
+    for (std::size_t k = 0; k < col_names.size(); ++k) {
+        if (k > 0) nb += '\t';
+        nb += col_names[k];
+    }
+    nb.resize(RoundUp(nb.size() + 1, 8), '\0');
+    std::uint64_t ncols = col_names.size();
+    std::uint64_t npops = pop_offsets.size() - 1;
+    std::uint64_t nrows = pop_offsets.back();
+    std::size_t offs_pos = HeaderSize + nb.size();
+    std::uint64_t data_off = RoundUp(offs_pos + 8*(npops + 1), DataAlign);
+    std::uint64_t hd[5] = {ncols, nrows, npops, nb.size(), data_off};
+    nexpect = ncols*nrows;
+    std::vector<char> head(data_off, '\0');
+    std::memcpy(&head[0], Magic, sizeof(Magic));
+    std::memcpy(&head[8], &PopBinVersion, 4);
+    std::memcpy(&head[12], &ByteOrderTag, 4);
+    std::memcpy(&head[16], hd, sizeof(hd));
+    std::memcpy(&head[HeaderSize], nb.data(), nb.size());
+    std::memcpy(&head[offs_pos], pop_offsets.data(), 8*(npops + 1));
+    if (std::fwrite(head.data(), 1, head.size(), fp) != head.size()) {
+        ok = false;
+    }
+}
+
+void PopBinWriter::Flush()
+{
+    if (nbuf > 0 && std::fwrite(buf.data(), sizeof(double), nbuf, fp) != nbuf) {
+        ok = false;
+    }
+    nput += nbuf;
+    nbuf = 0;
+}
+
+bool PopBinWriter::Close()
+{
+    Flush();
+    return ok && nput == nexpect;
+}
+
+
+//********************** Conversion to and from text *********************
+
+bool PopTextToBin(const std::string& infilename,
+                  const std::string& outfilename)
+{
+    std::ifstream infile(infilename.c_str());
+    if (!infile) {
+        std::cerr << "Could not open file " << infilename << '\n';
+        return false;
+    }
+    std::string line;
+    std::getline(infile, line);
+    if (!line.empty() && line.back() == '\r') line.pop_back();
+    std::vector<std::string> names = SplitColHeads(line);
+    std::size_t ncols = names.size();
+    std::size_t spcol = std::find(names.begin(), names.end(), "SubPop")
+        - names.begin();
+    if (spcol == ncols) {
+        std::cerr << "No SubPop column in " << infilename << '\n';
+        return false;
+    }
+    // read all rows, remembering the subpopulation number of each
+    std::vector<double> vals;
+    std::vector<std::pair<std::size_t, std::size_t>> rows; // (spn, row)
+    std::size_t npops = 0;
+    std::size_t line_num = 1;
+    while (std::getline(infile, line)) {
+        ++line_num;
+        if (line.find_first_not_of(" \t\r") == std::string::npos) continue;
+        std::istringstream ist(line);
+        for (std::size_t k = 0; k < ncols; ++k) {
+            double v = 0.0;
+            if (!(ist >> v)) {
+                std::cerr << "Invalid row " << rows.size() + 1 << " (line "
+                          << line_num << ") in " << infilename << '\n';
+                return false;
+            }
+            vals.push_back(v);
+        }
+        // the subpopulation number must be a non-negative integer
+        double spv = vals[vals.size() - ncols + spcol];
+        if (!(spv >= 0.0 && spv < MaxSubPops) || spv != std::floor(spv)) {
+            std::cerr << "Invalid SubPop " << spv << " on line " << line_num
+                      << " in " << infilename << " (must be an integer "
+                      << "from 0 to " << MaxSubPops - 1 << ")\n";
+            return false;
+        }
+        std::size_t spn = static_cast<std::size_t>(spv);
+        rows.emplace_back(spn, rows.size());
+        npops = std::max(npops, spn + 1);
+    }
+    std::stable_sort(rows.begin(), rows.end(),
+        [](const std::pair<std::size_t, std::size_t>& a,
+           const std::pair<std::size_t, std::size_t>& b)
+        { return a.first < b.first; });
+    std::vector<std::uint64_t> offs(npops + 1, 0);
+    for (const auto& r : rows) ++offs[r.first + 1];
+    for (std::size_t k = 0; k < npops; ++k) offs[k + 1] += offs[k];
+    std::FILE* fp = std::fopen(outfilename.c_str(), "wb");
+    if (!fp) {
+        std::cerr << "Cannot open " << outfilename << '\n';
+        return false;
+    }
+    PopBinWriter pbw(fp, names, offs);
+    for (std::size_t k = 0; k < ncols; ++k) {
+        for (const auto& r : rows) pbw.Put(vals[r.second*ncols + k]);
+    }
+    bool OK = pbw.Close();
+    if (std::fclose(fp) != 0) OK = false;
+    if (!OK) std::cerr << "Failed to write " << outfilename << '\n';
+    return OK;
+}
+
+bool PopBinToText(const std::string& infilename,
+                  const std::string& outfilename,
+                  int prec)
+{
+    MappedFile mf(infilename);
+    if (!mf) {
+        std::cerr << "Could not open file " << infilename << '\n';
+        return false;
+    }
+    PopBinView pbv(mf.Data(), mf.Size());
+    if (!pbv.OK()) {
+        std::cerr << infilename << ": " << pbv.Error() << '\n';
+        return false;
+    }
+    TextWriter outfile(outfilename, prec);
+    if (!outfile) {
+        std::cerr << "Cannot open " << outfilename << '\n';
+        return false;
+    }
+    outfile.Put(pbv.ColHeads());
+    outfile.Put('\n');
+    for (std::size_t i = 0; i < pbv.NumRows(); ++i) {
+        for (std::size_t k = 0; k < pbv.NumCols(); ++k) {
+            if (k > 0) outfile.Put('\t');
+            outfile.Put(pbv.Column(k)[i]);
+        }
+        outfile.Put('\n');
+    }
+    return outfile.Close();
+}
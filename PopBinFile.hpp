@@ -0,0 +1,139 @@
+#ifndef POPBINFILE_HPP
+#define POPBINFILE_HPP
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+
+// The EvoProg program runs actor-critic learning simulations
+// Copyright (C) 2019  Olof Leimar
+// See Readme.md for copyright notice
+
+// This unit implements a versioned binary, column-oriented file format for
+// populations, as an alternative to the tab-separated text files. A file
+// consists of a header, the column names (the schema), the offsets of the
+// subpopulations, and the data, with one contiguous array of doubles per
+// column. The rows are ordered by subpopulation, so that the rows of
+// subpopulation k are in the range [PopBegin(k), PopEnd(k)). The data start
+// at an offset that is a multiple of 64, which means that a memory-mapped file
+// can be used directly, without any parsing.
+//
+// Layout (all integers are unsigned and in native byte order):
+//   char     magic[8]     "PGGPOPB" followed by '\0'
+//   uint32   version
+//   uint32   byte order tag (0x01020304 in native order)
+//   uint64   number of columns, ncols
+//   uint64   number of rows, nrows
+//   uint64   number of subpopulations, npops
+//   uint64   size in bytes of the column name block
+//   uint64   offset in bytes of the data
+//   char[]   column names, tab-separated, padded with '\0' to a multiple of 8
+//   uint64   npops + 1 subpopulation row offsets
+//   (padding up to the data offset)
+//   double   ncols arrays of nrows values
+
+// Files with this extension use the binary format
+const char* const PopBinExt = ".pgb";
+const std::uint32_t PopBinVersion = 1;
+
+// Returns true if the file name has the extension of the binary format
+bool IsPopBinName(const std::string& filename);
+
+// Split a tab-separated string of column heads into names
+std::vector<std::string> SplitColHeads(const std::string& col_heads);
+
+
+//************************** Class MappedFile ****************************
+
+// Read-only memory mapping of a complete file
+
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& filename);
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    bool operator!() const { return data == nullptr; }
+    const char* Data() const { return data; }
+    std::size_t Size() const { return size; }
+private:
+    const char* data;
+    std::size_t size;
+};
+
+
+//************************** Class PopBinView ****************************
+
+// A view of population data in the binary format, located in memory (for
+// instance a MappedFile); the view does not copy any data
+
+class PopBinView {
+public:
+    PopBinView(const char* a_data, std::size_t a_size);
+    bool OK() const { return ok; }
+    const std::string& Error() const { return err; }
+    std::size_t NumCols() const { return ncols; }
+    std::size_t NumRows() const { return nrows; }
+    std::size_t NumPops() const { return npops; }
+    const std::string& ColName(std::size_t k) const { return names[k]; }
+    std::string ColHeads() const;
+    // Returns the index of the named column, or NumCols() if not present
+    std::size_t ColIndex(const std::string& name) const;
+    const double* Column(std::size_t k) const { return cols + k*nrows; }
+    std::size_t PopBegin(std::size_t k) const { return offs[k]; }
+    std::size_t PopEnd(std::size_t k) const { return offs[k + 1]; }
+private:
+    bool Fail(const std::string& msg) { err = msg; ok = false; return ok; }
+    bool ok;
+    std::string err;
+    std::size_t ncols;
+    std::size_t nrows;
+    std::size_t npops;
+    std::vector<std::string> names;
+    const std::uint64_t* offs;
+    const double* cols;
+};
+
+
+//************************* Class PopBinWriter ***************************
+
+// Writes a population in the binary format to an open file; after
+// construction (which writes the header), the values should be passed to
+// Put(), one column after the other, with the rows in each column ordered by
+// subpopulation, after which Close() should be called
+
+class PopBinWriter {
+public:
+    PopBinWriter(std::FILE* a_fp,
+                 const std::vector<std::string>& col_names,
+                 const std::vector<std::uint64_t>& pop_offsets);
+    void Put(double v)
+    { buf[nbuf++] = v; if (nbuf == buf.size()) Flush(); }
+    // Returns true if all data were written
+    bool Close();
+private:
+    void Flush();
+    std::FILE* fp;
+    std::vector<double> buf;
+    std::size_t nbuf;
+    std::uint64_t nput;
+    std::uint64_t nexpect;
+    bool ok;
+};
+
+
+//********************** Conversion to and from text *********************
+
+// Convert a tab-separated population file (with column heads on the first
+// line) to the binary format; rows are grouped by the SubPop column
+bool PopTextToBin(const std::string& infilename,
+                  const std::string& outfilename);
+
+// Convert a binary population file to the tab-separated text format, by
+// default with values written round-trip exact (see TextWriter.hpp)
+bool PopBinToText(const std::string& infilename,
+                  const std::string& outfilename,
+                  int prec = 0);
+
+#endif // POPBINFILE_HPP
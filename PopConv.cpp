@@ -0,0 +1,30 @@
+#include "PopBinFile.hpp"
+#include <iostream>
+#include <string>
+
+// The EvoProg program runs actor-critic learning simulations
+// Copyright (C) 2019  Olof Leimar
+// See Readme.md for copyright notice
+
+// Converts population files between the tab-separated text format and the
+// binary format; the direction is given by the extension of the input file,
+// for instance
+//     ./PopConv.exe Data/Run01.txt Data/Run01.pgb
+//     ./PopConv.exe Data/Run01.pgb Data/Run01.txt
+
+int main(int argc, char* argv[])
+{
+    if (argc != 3) {
+        std::cout << "Usage: " << argv[0] << " infile outfile\n";
+        return -1;
+    }
+    std::string inname(argv[1]);
+    std::string outname(argv[2]);
+    bool OK = IsPopBinName(inname) ? PopBinToText(inname, outname)
+                                   : PopTextToBin(inname, outname);
+    if (!OK) {
+        std::cout << "Conversion failed!\n";
+        return -1;
+    }
+    return 0;
+}
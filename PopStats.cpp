@@ -0,0 +1,111 @@
+#include "PopStats.hpp"
+#include <algorithm>
+#include <utility>
+
+// The EvoProg program runs actor-critic learning simulations
+// Copyright (C) 2019  Olof Leimar
+// See Readme.md for copyright notice
+
+//*************************** Struct RunStat *****************************
+
+void RunStat::Merge(const RunStat& o)
+{
+    if (o.n == 0) return;
+    if (n == 0) {
+        *this = o;
+        return;
+    }
+    std::size_t nt = n + o.n;
+    double dx = o.mean - mean;
+    mean += dx*o.n/nt;
+    m2 += o.m2 + dx*dx*(static_cast<double>(n)*o.n/nt);
+    n = nt;
+}
+
+
+//************************** Class QuantSketch ***************************
+
+void QuantSketch::Add(double x)
+{
+    if (levels.empty()) levels.emplace_back();
+    levels[0].push_back(x);
+    if (levels[0].size() > k) Compact(0);
+}
+
+void QuantSketch::Merge(const QuantSketch& o)
+{
+    if (levels.size() < o.levels.size()) levels.resize(o.levels.size());
+    for (std::size_t lev = 0; lev < o.levels.size(); ++lev) {
+        levels[lev].insert(levels[lev].end(),
+                           o.levels[lev].begin(), o.levels[lev].end());
+    }
+    for (std::size_t lev = 0; lev < levels.size(); ++lev) {
+        if (levels[lev].size() > k) Compact(lev);
+    }
+}
+
+void QuantSketch::Compact(std::size_t lev)
+{
+    if (levels.size() == lev + 1) levels.emplace_back();
+    std::vector<double>& cur = levels[lev];
+    std::vector<double>& up = levels[lev + 1];
+    std::sort(cur.begin(), cur.end());
+    // with an odd number of values, the largest stays at this level
+    std::size_t n = cur.size() & ~std::size_t(1);
+    for (std::size_t i = odd ? 1 : 0; i < n; i += 2) up.push_back(cur[i]);
+    odd = !odd;
+    if (n < cur.size()) {
+        cur[0] = cur.back();
+        cur.resize(1);
+    } else {
+        cur.clear();
+    }
+    // the next level may in turn need compaction
+    if (up.size() > k) Compact(lev + 1);
+}
+
+double QuantSketch::Quantile(double p) const
+{
+    std::vector<std::pair<double, double>> vw;
+    double wtot = 0.0;
+    double w = 1.0;
+    for (const auto& lv : levels) {
+        for (double x : lv) vw.emplace_back(x, w);
+        wtot += w*lv.size();
+        w *= 2.0;
+    }
+    if (vw.empty()) return 0.0;
+    std::sort(vw.begin(), vw.end());
+    double target = p*wtot;
+    double cum = 0.0;
+    for (const auto& v : vw) {
+        cum += v.second;
+        if (cum >= target) return v.first;
+    }
+    return vw.back().first;
+}
+
+
+//************************* Struct TraitStats ****************************
+
+void TraitStats::Merge(const TraitStats& o)
+{
+    for (std::size_t t = 0; t < num_stat_traits; ++t) {
+        rs[t].Merge(o.rs[t]);
+        qs[t].Merge(o.qs[t]);
+    }
+}
+
+void TraitStats::clear()
+{
+    for (std::size_t t = 0; t < num_stat_traits; ++t) {
+        rs[t].clear();
+        qs[t].clear();
+    }
+}
+
+std::string StatColHeads()
+{
+    return "gen\tphase\tSubPop\ttrait\tn\tmean\tsd\t"
+        "q05\tq25\tq50\tq75\tq95";
+}
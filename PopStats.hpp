@@ -0,0 +1,107 @@
+#ifndef POPSTATS_HPP
+#define POPSTATS_HPP
+
+#include <array>
+#include <string>
+#include <vector>
+#include <cmath>
+
+// The EvoProg program runs actor-critic learning simulations
+// Copyright (C) 2019  Olof Leimar
+// See Readme.md for copyright notice
+
+// This unit provides summary statistics of populations that can be computed
+// in a single pass, separately for different parts of a population (for
+// instance subpopulations handled by different threads), and then merged.
+
+//*************************** Struct RunStat *****************************
+
+// Mean and variance, computed with Welford's method, with merging of
+// accumulators using the formula of Chan et al.
+
+struct RunStat {
+// public:
+    void Add(double x)
+    {
+        ++n;
+        double dx = x - mean;
+        mean += dx/n;
+        m2 += dx*(x - mean);
+    }
+    void Merge(const RunStat& o);
+    void clear() { n = 0; mean = 0.0; m2 = 0.0; }
+    double Var() const { return (n > 1) ? m2/(n - 1) : 0.0; }
+    double SD() const { return std::sqrt(Var()); }
+    // public data members
+    std::size_t n = 0;
+    double mean = 0.0;
+    double m2 = 0.0;    // sum of squared deviations from mean
+};
+
+
+//************************** Class QuantSketch ***************************
+
+// A mergeable sketch for approximate quantiles, with bounded memory. Values
+// are stored in levels, where a value at level i represents 2^i of the values
+// added. When a level holds more than k values, they are sorted and every
+// other value (alternating between the odd and even ones) is moved up to the
+// next level. For up to k values the quantiles are exact, and in general the
+// rank error is of order log2(n/k)/k.
+
+class QuantSketch {
+public:
+    explicit QuantSketch(std::size_t a_k = 128) : k{a_k}, odd{false} {}
+    void Add(double x);
+    void Merge(const QuantSketch& o);
+    void clear() { levels.clear(); }
+    // Approximate p-quantile, 0 <= p <= 1
+    double Quantile(double p) const;
+private:
+    void Compact(std::size_t lev);
+    std::size_t k;
+    bool odd;
+    std::vector<std::vector<double>> levels;
+};
+
+
+//************************* Struct TraitStats ****************************
+
+// Statistics for the traits reported per generation: the three genetically
+// determined traits, and the learning outcomes theta, w and payoff
+
+enum StatTrait { st_d, st_theta0, st_w0, st_theta, st_w, st_payoff,
+                 num_stat_traits };
+
+// Names of traits, in the order of StatTrait
+const std::array<const char*, num_stat_traits> StatTraitNames =
+    {{"d", "theta0", "w0", "theta", "w", "payoff"}};
+
+// Quantiles reported for each trait
+const std::array<double, 5> StatQuantiles = {{0.05, 0.25, 0.5, 0.75, 0.95}};
+
+struct TraitStats {
+// public:
+    // Add the traits of a phenotype, PhenType should have public members d,
+    // theta0, w0, theta, w and payoff
+    template<typename PhenType>
+    void Add(const PhenType& ph)
+    {
+        Add(st_d, ph.d);
+        Add(st_theta0, ph.theta0);
+        Add(st_w0, ph.w0);
+        Add(st_theta, ph.theta);
+        Add(st_w, ph.w);
+        Add(st_payoff, ph.payoff);
+    }
+    void Add(StatTrait t, double x) { rs[t].Add(x); qs[t].Add(x); }
+    void Merge(const TraitStats& o);
+    void clear();
+    // public data members
+    std::array<RunStat, num_stat_traits> rs;
+    std::array<QuantSketch, num_stat_traits> qs;
+};
+
+// Column heads for the per-generation statistics table
+std::string StatColHeads();
+
+#endif // POPSTATS_HPP
@@ -0,0 +1,92 @@
+#include "PopStore.hpp"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+// The EvoProg program runs actor-critic learning simulations
+// Copyright (C) 2019  Olof Leimar
+// See Readme.md for copyright notice
+
+//*************************** Class PopStore *****************************
+
+bool PopStore::Open(const std::string& filename, std::size_t rec_size,
+                    std::size_t num_slots, std::size_t slot_recs)
+{
+    Close();
+    err.clear();
+    rec_sz = rec_size;
+    num_sl = num_slots;
+    slot_rc = slot_recs;
+    bytes_read = 0;
+    bytes_written = 0;
+    fd = open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0) {
+        err = "cannot create " + filename + " (" + std::strerror(errno) + ")";
+        return false;
+    }
+    // the file stays available through fd
+    unlink(filename.c_str());
+    if (ftruncate(fd, static_cast<off_t>(FileBytes())) != 0) {
+        err = "cannot set size of " + filename + " ("
+            + std::strerror(errno) + ")";
+        Close();
+        return false;
+    }
+    return true;
+}
+
+void PopStore::Close()
+{
+    if (fd >= 0) {
+        close(fd);
+        fd = -1;
+    }
+}
+
+bool PopStore::Read(std::size_t slot, std::size_t rec, std::size_t nrec,
+                    void* buf)
+{
+    return Transfer(false, slot, rec, nrec, static_cast<char*>(buf));
+}
+
+bool PopStore::Write(std::size_t slot, std::size_t rec, std::size_t nrec,
+                     const void* buf)
+{
+    return Transfer(true, slot, rec, nrec,
+                    static_cast<char*>(const_cast<void*>(buf)));
+}
+
+bool PopStore::Transfer(bool write, std::size_t slot, std::size_t rec,
+                        std::size_t nrec, char* buf)
+{
+    if (fd < 0 || slot >= num_sl || rec + nrec > slot_rc) {
+        err = "invalid position in store";
+        return false;
+    }
+    std::uint64_t off = (static_cast<std::uint64_t>(slot)*slot_rc + rec)
+        *rec_sz;
+    std::size_t left = nrec*rec_sz;
+    // pread and pwrite may transfer less than asked for
+    while (left > 0) {
+        ssize_t n = write ?
+            pwrite(fd, buf, left, static_cast<off_t>(off)) :
+            pread(fd, buf, left, static_cast<off_t>(off));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            err = std::string(write ? "write" : "read") + " failed ("
+                + (n < 0 ? std::strerror(errno) : "end of file") + ")";
+            return false;
+        }
+        buf += n;
+        off += n;
+        left -= n;
+        if (write) {
+            bytes_written += n;
+        } else {
+            bytes_read += n;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,170 @@
+#ifndef POPSTORE_HPP
+#define POPSTORE_HPP
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// The EvoProg program runs actor-critic learning simulations
+// Copyright (C) 2019  Olof Leimar
+// See Readme.md for copyright notice
+
+//*************************** Class PopStore *****************************
+
+// A disk-backed store of a metapopulation, for runs with populations that do
+// not fit in memory (see EvoStore.cpp). The store is a file with num_slots
+// slots (subpopulations) of slot_recs records (individuals) of rec_size
+// bytes, and records are read and written at their positions in the file.
+// The file is removed as soon as it has been created, so it disappears when
+// the store is closed, also if the program stops unexpectedly. Reading and
+// writing can be done from different threads, as long as they do not use the
+// same records at the same time.
+
+class PopStore {
+public:
+    PopStore() = default;
+    ~PopStore() { Close(); }
+    PopStore(const PopStore&) = delete;
+    PopStore& operator=(const PopStore&) = delete;
+    bool Open(const std::string& filename, std::size_t rec_size,
+              std::size_t num_slots, std::size_t slot_recs);
+    void Close();
+    bool IsOpen() const { return fd >= 0; }
+    // Read or write nrec records, starting with record rec of slot
+    bool Read(std::size_t slot, std::size_t rec, std::size_t nrec, void* buf);
+    bool Write(std::size_t slot, std::size_t rec, std::size_t nrec,
+               const void* buf);
+    std::uint64_t BytesRead() const { return bytes_read; }
+    std::uint64_t BytesWritten() const { return bytes_written; }
+    std::uint64_t FileBytes() const
+    { return static_cast<std::uint64_t>(rec_sz)*num_sl*slot_rc; }
+    const std::string& Error() const { return err; }
+private:
+    bool Transfer(bool write, std::size_t slot, std::size_t rec,
+                  std::size_t nrec, char* buf);
+    int fd = -1;
+    std::size_t rec_sz = 0;
+    std::size_t num_sl = 0;
+    std::size_t slot_rc = 0;
+    std::uint64_t bytes_read = 0;
+    std::uint64_t bytes_written = 0;
+    std::string err;
+};
+
+
+//************************** Class PopScatter ****************************
+
+// The external shuffle used for migration with a population store: each
+// individual added is sent to a random slot of the destination store, with
+// probability proportional to the number of free positions left in the slot.
+// The slots then hold a random partition of the individuals, and shuffling
+// each slot when it is read back completes a random permutation of the
+// metapopulation, as in Evo::Migrate. The free positions are kept in a
+// Fenwick tree, so that a slot is found in O(log(num_slots)) steps, and
+// individuals are collected in a buffer of buf_recs records per slot, which
+// is written when it is full.
+
+template<typename Ind>
+class PopScatter {
+public:
+    static_assert(std::is_trivially_copyable<Ind>::value,
+                  "records of a PopStore are copied as bytes");
+    PopScatter(std::size_t num_slots, std::size_t slot_recs,
+               std::size_t buf_recs);
+    // Start sending individuals to dest
+    void Reset(PopStore* dest);
+    template<typename Eng>
+    bool Add(const Ind& indi, Eng& eng);
+    // Write what remains in the buffers
+    bool Flush();
+private:
+    bool FlushSlot(std::size_t slot);
+    std::size_t ns;
+    std::size_t nrec;
+    std::size_t nbuf;
+    PopStore* store;
+    std::vector<std::uint64_t> tree;    // Fenwick tree of free positions
+    std::uint64_t free_tot;
+    std::size_t top_bit;
+    std::vector<std::size_t> written;   // records written, per slot
+    std::vector<std::size_t> buffered;  // records in buffer, per slot
+    std::vector<Ind> bufs;
+};
+
+template<typename Ind>
+PopScatter<Ind>::PopScatter(std::size_t num_slots, std::size_t slot_recs,
+                            std::size_t buf_recs) :
+    ns{num_slots},
+    nrec{slot_recs},
+    nbuf{buf_recs > 0 ? buf_recs : 1},
+    store{nullptr},
+    tree(num_slots + 1, 0),
+    free_tot{0},
+    top_bit{1},
+    written(num_slots, 0),
+    buffered(num_slots, 0),
+    bufs(num_slots*nbuf)
+{
+    while (2*top_bit <= ns) top_bit *= 2;
+}
+
+template<typename Ind>
+void PopScatter<Ind>::Reset(PopStore* dest)
+{
+    store = dest;
+    // every slot has nrec free positions
+    for (std::size_t i = 1; i <= ns; ++i) {
+        tree[i] = nrec*(i & (~i + 1));
+    }
+    free_tot = static_cast<std::uint64_t>(ns)*nrec;
+    written.assign(ns, 0);
+    buffered.assign(ns, 0);
+}
+
+template<typename Ind>
+template<typename Eng>
+bool PopScatter<Ind>::Add(const Ind& indi, Eng& eng)
+{
+    if (free_tot == 0) return false;
+    std::uniform_int_distribution<std::uint64_t> ud(0, free_tot - 1);
+    std::uint64_t r = ud(eng);
+    // find the slot with cumulative free positions above r
+    std::size_t pos = 0;
+    for (std::size_t step = top_bit; step > 0; step /= 2) {
+        if (pos + step <= ns && tree[pos + step] <= r) {
+            pos += step;
+            r -= tree[pos];
+        }
+    }
+    std::size_t slot = pos;
+    for (std::size_t i = slot + 1; i <= ns; i += i & (~i + 1)) --tree[i];
+    --free_tot;
+    bufs[slot*nbuf + buffered[slot]] = indi;
+    if (++buffered[slot] == nbuf) return FlushSlot(slot);
+    return true;
+}
+
+template<typename Ind>
+bool PopScatter<Ind>::FlushSlot(std::size_t slot)
+{
+    std::size_t nb = buffered[slot];
+    if (nb == 0) return true;
+    buffered[slot] = 0;
+    std::size_t rec = written[slot];
+    written[slot] += nb;
+    return store->Write(slot, rec, nb, &bufs[slot*nbuf]);
+}
+
+template<typename Ind>
+bool PopScatter<Ind>::Flush()
+{
+    bool ok = true;
+    for (std::size_t slot = 0; slot < ns; ++slot) {
+        if (!FlushSlot(slot)) ok = false;
+    }
+    return ok;
+}
+
+#endif // POPSTORE_HPP
@@ -0,0 +1,291 @@
+#ifndef RANDENG_HPP
+#define RANDENG_HPP
+
+#include <array>
+#include <cstdint>
+#include <istream>
+#include <limits>
+#include <ostream>
+#include <random>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// The EvoProg program runs actor-critic learning simulations
+// Copyright (C) 2019  Olof Leimar
+// See Readme.md for copyright notice
+
+// This header provides the random number engine used in the simulation, as a
+// single type RandEng, which is used by Evo, ActCritGroup, MutRec and the
+// mutational increment structs. The engine is selected when compiling:
+// std::mt19937 by default (as in earlier versions, so that results are
+// unchanged), Xoshiro256pp with PGG_RANDENG_XOSHIRO defined, and Philox4x32
+// with PGG_RANDENG_PHILOX defined (see the Makefile variable RANDENG). The
+// two other engines have a small state (32 bytes, compared with 2.5 kB for
+// std::mt19937) and produce 64 bits per call, which is faster, in particular
+// for the distributions of real numbers. Both engines meet the requirements
+// of a uniform random bit generator, so they can be used with the standard
+// distributions, and they have a jump() function, which gives separate
+// streams of random numbers for threads. Their states can be written and
+// read with the stream operators, as for the standard engines.
+
+//**************************** SplitMix64 ********************************
+
+// A simple generator, used to expand a seed into the state of an engine
+
+inline std::uint64_t SplitMix64(std::uint64_t& x)
+{
+    std::uint64_t z = (x += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30))*0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27))*0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+
+//************************* Class Xoshiro256pp ***************************
+
+// The xoshiro256++ generator of Blackman and Vigna (2019), with a period of
+// 2^256 - 1; jump() advances the state by 2^128 steps, and long_jump() by
+// 2^192 steps
+
+class Xoshiro256pp {
+public:
+    using result_type = std::uint64_t;
+    static constexpr const char* Name = "xoshiro256pp";
+    static constexpr result_type default_seed = 5489u;
+    explicit Xoshiro256pp(result_type sd = default_seed) { seed(sd); }
+    explicit Xoshiro256pp(std::seed_seq& ss) { seed(ss); }
+    void seed(result_type sd)
+    {
+        std::uint64_t x = sd;
+        for (auto& w : s) w = SplitMix64(x);
+    }
+    void seed(std::seed_seq& ss)
+    {
+        std::array<std::uint32_t, 8> v;
+        ss.generate(v.begin(), v.end());
+        for (std::size_t i = 0; i < 4; ++i) {
+            s[i] = (std::uint64_t(v[2*i]) << 32) | v[2*i + 1];
+        }
+        if (s[0] == 0 && s[1] == 0 && s[2] == 0 && s[3] == 0) s[0] = 1;
+    }
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max()
+    { return std::numeric_limits<result_type>::max(); }
+    result_type operator()()
+    {
+        const std::uint64_t result = Rotl(s[0] + s[3], 23) + s[0];
+        const std::uint64_t t = s[1] << 17;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = Rotl(s[3], 45);
+        return result;
+    }
+    void discard(unsigned long long z) { while (z-- > 0) (*this)(); }
+    void jump()
+    {
+        static const std::uint64_t jmp[] = {
+            0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL,
+            0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL};
+        Jump(jmp);
+    }
+    void long_jump()
+    {
+        static const std::uint64_t jmp[] = {
+            0x76e15d3efefdcbbfULL, 0xc5004e441c522fb3ULL,
+            0x77710069854ee241ULL, 0x39109bb02acbe635ULL};
+        Jump(jmp);
+    }
+    friend bool operator==(const Xoshiro256pp& a, const Xoshiro256pp& b)
+    { return a.s == b.s; }
+    friend bool operator!=(const Xoshiro256pp& a, const Xoshiro256pp& b)
+    { return !(a == b); }
+    friend std::ostream& operator<<(std::ostream& os, const Xoshiro256pp& e)
+    { return os << e.s[0] << ' ' << e.s[1] << ' ' << e.s[2] << ' ' << e.s[3]; }
+    friend std::istream& operator>>(std::istream& is, Xoshiro256pp& e)
+    { return is >> e.s[0] >> e.s[1] >> e.s[2] >> e.s[3]; }
+private:
+    static std::uint64_t Rotl(std::uint64_t x, int k)
+    { return (x << k) | (x >> (64 - k)); }
+    void Jump(const std::uint64_t* jmp)
+    {
+        std::array<std::uint64_t, 4> t{};
+        for (int i = 0; i < 4; ++i) {
+            for (int b = 0; b < 64; ++b) {
+                if (jmp[i] & (std::uint64_t(1) << b)) {
+                    for (int k = 0; k < 4; ++k) t[k] ^= s[k];
+                }
+                (*this)();
+            }
+        }
+        s = t;
+    }
+    std::array<std::uint64_t, 4> s;
+};
+
+
+//************************** Class Philox4x32 ****************************
+
+// The counter-based Philox4x32-10 generator of Salmon et al. (2011): the
+// random numbers are an encryption-like function of a 128-bit counter and a
+// 64-bit key, giving four 32-bit numbers per counter value, which are
+// returned as two 64-bit numbers; jump() advances the counter by 2^64
+
+class Philox4x32 {
+public:
+    using result_type = std::uint64_t;
+    static constexpr const char* Name = "philox4x32";
+    static constexpr result_type default_seed = 5489u;
+    explicit Philox4x32(result_type sd = default_seed) { seed(sd); }
+    explicit Philox4x32(std::seed_seq& ss) { seed(ss); }
+    void seed(result_type sd)
+    {
+        std::uint64_t x = sd;
+        std::uint64_t k = SplitMix64(x);
+        key = {{static_cast<std::uint32_t>(k),
+                static_cast<std::uint32_t>(k >> 32)}};
+        ctr.fill(0);
+        pos = 4;
+    }
+    void seed(std::seed_seq& ss)
+    {
+        ss.generate(key.begin(), key.end());
+        ctr.fill(0);
+        pos = 4;
+    }
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max()
+    { return std::numeric_limits<result_type>::max(); }
+    result_type operator()()
+    {
+        if (pos >= 4) {
+            Block();
+            pos = 0;
+        }
+        result_type r = (std::uint64_t(out[pos]) << 32) | out[pos + 1];
+        pos += 2;
+        return r;
+    }
+    void discard(unsigned long long z) { while (z-- > 0) (*this)(); }
+    void jump()
+    {
+        if (++ctr[2] == 0) ++ctr[3];
+        pos = 4;
+    }
+    friend bool operator==(const Philox4x32& a, const Philox4x32& b)
+    {
+        return a.key == b.key && a.ctr == b.ctr && a.pos == b.pos &&
+            (a.pos >= 4 || a.out == b.out);
+    }
+    friend bool operator!=(const Philox4x32& a, const Philox4x32& b)
+    { return !(a == b); }
+    // the state is the key, the counter and the position in the current
+    // block (which is recomputed when reading)
+    friend std::ostream& operator<<(std::ostream& os, const Philox4x32& e)
+    {
+        return os << e.key[0] << ' ' << e.key[1] << ' ' << e.ctr[0] << ' '
+                  << e.ctr[1] << ' ' << e.ctr[2] << ' ' << e.ctr[3] << ' '
+                  << e.pos;
+    }
+    friend std::istream& operator>>(std::istream& is, Philox4x32& e)
+    {
+        is >> e.key[0] >> e.key[1] >> e.ctr[0] >> e.ctr[1] >> e.ctr[2]
+           >> e.ctr[3] >> e.pos;
+        if (is && e.pos < 4) {
+            // the block for the previous counter value
+            e.Decrement();
+            e.Block();
+        }
+        return is;
+    }
+private:
+    // compute the block for the counter, and increment the counter
+    void Block()
+    {
+        const std::uint32_t M0 = 0xD2511F53;
+        const std::uint32_t M1 = 0xCD9E8D57;
+        const std::uint32_t W0 = 0x9E3779B9;
+        const std::uint32_t W1 = 0xBB67AE85;
+        std::array<std::uint32_t, 4> c = ctr;
+        std::array<std::uint32_t, 2> k = key;
+        for (int r = 0; r < 10; ++r) {
+            std::uint64_t p0 = std::uint64_t(M0)*c[0];
+            std::uint64_t p1 = std::uint64_t(M1)*c[2];
+            std::uint32_t hi0 = static_cast<std::uint32_t>(p0 >> 32);
+            std::uint32_t lo0 = static_cast<std::uint32_t>(p0);
+            std::uint32_t hi1 = static_cast<std::uint32_t>(p1 >> 32);
+            std::uint32_t lo1 = static_cast<std::uint32_t>(p1);
+            c = {{hi1 ^ c[1] ^ k[0], lo1, hi0 ^ c[3] ^ k[1], lo0}};
+            k[0] += W0;
+            k[1] += W1;
+        }
+        out = c;
+        for (std::uint32_t& w : ctr) {
+            if (++w != 0) break;
+        }
+    }
+    void Decrement()
+    {
+        for (std::uint32_t& w : ctr) {
+            if (w-- != 0) break;
+        }
+    }
+    std::array<std::uint32_t, 2> key;
+    std::array<std::uint32_t, 4> ctr;
+    std::array<std::uint32_t, 4> out;
+    unsigned pos;
+};
+
+
+//***************************** Selection ********************************
+
+#if defined(PGG_RANDENG_XOSHIRO)
+using RandEng = Xoshiro256pp;
+#elif defined(PGG_RANDENG_PHILOX)
+using RandEng = Philox4x32;
+#else
+using RandEng = std::mt19937;
+#endif
+
+// Name of an engine type
+template<typename Eng>
+inline const char* EngineName() { return Eng::Name; }
+
+template<>
+inline const char* EngineName<std::mt19937>() { return "mt19937"; }
+
+// Engines for n threads: engines with jump() get one seed, sds[0], and the
+// engine of thread i is jumped i times, so that the streams of random numbers
+// do not overlap; other engines get the seed sds[i]
+template<typename Eng, typename = void>
+struct HasJump : std::false_type {};
+
+template<typename Eng>
+struct HasJump<Eng, std::void_t<decltype(std::declval<Eng&>().jump())>> :
+    std::true_type {};
+
+template<typename Eng>
+std::vector<Eng> ThreadEngines(const std::vector<unsigned>& sds,
+                               std::size_t n)
+{
+    std::vector<Eng> engs;
+    engs.reserve(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        if constexpr (HasJump<Eng>::value) {
+            if (i == 0) {
+                engs.emplace_back(sds[0]);
+            } else {
+                engs.push_back(engs[i - 1]);
+                engs.back().jump();
+            }
+        } else {
+            engs.emplace_back(sds[i]);
+        }
+    }
+    return engs;
+}
+
+#endif // RANDENG_HPP
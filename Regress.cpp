@@ -0,0 +1,415 @@
+#include "InpFile.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// The EvoProg program runs actor-critic learning simulations
+// Copyright (C) 2019  Olof Leimar
+// See Readme.md for copyright notice
+
+// End-to-end regression test of the EvoProg program, over scaled-down
+// versions of the example runs in the Data directory, with fixed seeds and a
+// single thread. Build and run with make regress, or run as
+//     ./Regress.exe [--update] [--dir D] [--prog P] [--seed S] [--reps R]
+// Each workload is run as a separate process, R times (default 3), and the
+// shortest of the times is used, which reduces the influence of other
+// activity on the computer. The wall time, learning
+// throughput (individual time steps per second) and peak memory use are
+// compared with the baseline in Data/Regress_baseline.txt, where each metric
+// has a relative tolerance. In addition, the whole-population means of the
+// traits after learning in the last generation are checked against the ranges
+// in Data/Regress_expected.txt, which catches changes that make the program
+// faster by doing something else. With --update, the baseline is rewritten
+// from the current results (keeping existing tolerances). The report is
+// written to std::cout as tab-separated text; the exit status is 1 if any
+// workload failed, regressed or gave statistics out of range. The expected
+// ranges were found by running with several seeds (--seed).
+
+namespace {
+
+const char* BaselineName = "Data/Regress_baseline.txt";
+const char* ExpectedName = "Data/Regress_expected.txt";
+
+// default relative tolerances for new baseline entries
+const double TimeTol = 0.30;
+const double MemTol = 0.20;
+
+// the default seed, used for all workloads
+const char* RegressSeed = "12345";
+
+// default number of repetitions of each workload
+const int RegressReps = 3;
+
+using override_type = std::vector<std::pair<std::string, std::string>>;
+
+struct Workload {
+// public:
+    std::string name;
+    std::string inp;            // shipped input file
+    override_type overrides;    // changes to scale down the run
+};
+
+// Run01 starts from the shipped population Data/Run00.txt, which it only
+// reads; the other runs construct their starting population from all0
+const std::vector<Workload> Workloads = {
+    {"Run00", "Data/Run00.inp", {}},
+    {"Run01", "Data/Run01.inp", {{"numgen", "30"}}},
+    {"Run02", "Data/Run02.inp", {{"ReadFromFile", "0"}}},
+    {"Run03", "Data/Run03.inp", {{"ReadFromFile", "0"}}},
+    {"Run12", "Data/Run12.inp", {{"ngsp", "50"}, {"T", "500"},
+                                 {"numgen", "20"}, {"ReadFromFile", "0"}}}
+};
+
+struct RunResult {
+// public:
+    bool ok = false;
+    double wall_seconds = 0.0;
+    double cpu_seconds = 0.0;
+    double peak_rss_mb = 0.0;
+};
+
+// the key of a line "key = value ; comment", or an empty string
+std::string LineKey(const std::string& line)
+{
+    std::string::size_type eq = line.find('=');
+    std::string::size_type cm = line.find_first_of(";#");
+    if (eq == std::string::npos || (cm != std::string::npos && cm < eq)) {
+        return std::string();
+    }
+    std::istringstream is(line.substr(0, eq));
+    std::string key;
+    is >> key;
+    return key;
+}
+
+// write a copy of the input file inp to outname, with the values of keys in
+// ovr replaced (keys not present are added at the end)
+bool WriteInp(const std::string& inp, const std::string& outname,
+              const override_type& ovr)
+{
+    std::ifstream is(inp.c_str());
+    if (!is) {
+        std::cerr << "Failed to open " << inp << '\n';
+        return false;
+    }
+    std::ofstream os(outname.c_str());
+    std::vector<bool> used(ovr.size(), false);
+    std::string line;
+    while (std::getline(is, line)) {
+        std::string key = LineKey(line);
+        bool replaced = false;
+        for (std::size_t i = 0; i < ovr.size(); ++i) {
+            if (key == ovr[i].first) {
+                os << ovr[i].first << " = " << ovr[i].second << '\n';
+                used[i] = true;
+                replaced = true;
+            }
+        }
+        if (!replaced) os << line << '\n';
+    }
+    for (std::size_t i = 0; i < ovr.size(); ++i) {
+        if (!used[i]) os << ovr[i].first << " = " << ovr[i].second << '\n';
+    }
+    return static_cast<bool>(os);
+}
+
+// run prog with argument inpname, with output to logname, and measure wall
+// time, CPU time and peak memory use of the child process
+RunResult RunProg(const std::string& prog, const std::string& inpname,
+                  const std::string& logname)
+{
+    RunResult res;
+    auto t0 = std::chrono::steady_clock::now();
+    pid_t pid = fork();
+    if (pid < 0) {
+        std::cerr << "fork failed: " << std::strerror(errno) << '\n';
+        return res;
+    }
+    if (pid == 0) {
+        int fd = open(logname.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd >= 0) {
+            dup2(fd, STDOUT_FILENO);
+            dup2(fd, STDERR_FILENO);
+            close(fd);
+        }
+        execl(prog.c_str(), prog.c_str(), inpname.c_str(),
+              static_cast<char*>(nullptr));
+        _exit(127);
+    }
+    int status = 0;
+    struct rusage ru;
+    if (wait4(pid, &status, 0, &ru) < 0) {
+        std::cerr << "wait4 failed: " << std::strerror(errno) << '\n';
+        return res;
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    res.ok = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    res.wall_seconds = std::chrono::duration<double>(t1 - t0).count();
+    res.cpu_seconds = ru.ru_utime.tv_sec + 1e-6*ru.ru_utime.tv_usec
+        + ru.ru_stime.tv_sec + 1e-6*ru.ru_stime.tv_usec;
+#ifdef __APPLE__
+    // in bytes on macOS
+    res.peak_rss_mb = ru.ru_maxrss/(1024.0*1024.0);
+#else
+    // in kilobytes on Linux
+    res.peak_rss_mb = ru.ru_maxrss/1024.0;
+#endif
+    return res;
+}
+
+// the whole-population means of traits after learning in the last generation
+// in a statistics file
+std::map<std::string, double> LastMeans(const std::string& statname)
+{
+    std::map<std::string, double> means;
+    std::ifstream is(statname.c_str());
+    std::string line;
+    std::getline(is, line); // header
+    int last_gen = 0;
+    while (std::getline(is, line)) {
+        std::istringstream ls(line);
+        int gen = 0;
+        int sp = 0;
+        std::string phase;
+        std::string trait;
+        double n = 0.0;
+        double mean = 0.0;
+        if (!(ls >> gen >> phase >> sp >> trait >> n >> mean)) continue;
+        if (phase != "learn" || sp != -1) continue;
+        if (gen > last_gen) {
+            means.clear();
+            last_gen = gen;
+        }
+        means[trait] = mean;
+    }
+    return means;
+}
+
+struct Baseline {
+// public:
+    double value;
+    double tol;
+};
+
+// baseline per workload and metric
+using baseline_map = std::map<std::pair<std::string, std::string>, Baseline>;
+
+bool IsComment(const std::string& line)
+{
+    return line.empty() || line[0] == '#';
+}
+
+baseline_map ReadBaseline(const std::string& filename)
+{
+    baseline_map bl;
+    std::ifstream is(filename.c_str());
+    std::string line;
+    while (std::getline(is, line)) {
+        if (IsComment(line)) continue;
+        std::istringstream ls(line);
+        std::string wl;
+        std::string metric;
+        Baseline b;
+        if (ls >> wl >> metric >> b.value >> b.tol) bl[{wl, metric}] = b;
+    }
+    return bl;
+}
+
+struct Range {
+// public:
+    double lo;
+    double hi;
+};
+
+using range_map = std::map<std::pair<std::string, std::string>, Range>;
+
+range_map ReadExpected(const std::string& filename)
+{
+    range_map rm;
+    std::ifstream is(filename.c_str());
+    std::string line;
+    while (std::getline(is, line)) {
+        if (IsComment(line)) continue;
+        std::istringstream ls(line);
+        std::string wl;
+        std::string trait;
+        Range r;
+        if (ls >> wl >> trait >> r.lo >> r.hi) rm[{wl, trait}] = r;
+    }
+    return rm;
+}
+
+// status of a metric compared with its baseline; for throughput higher is
+// better, and for time and memory lower is better
+std::string CompareStatus(const std::string& metric, double val,
+                          const Baseline& b)
+{
+    bool higher_better = metric.find("_per_s") != std::string::npos;
+    double rel = (b.value != 0.0) ? (val - b.value)/b.value : 0.0;
+    if (higher_better) rel = -rel;
+    if (rel > b.tol) return "REGRESSION";
+    if (rel < -b.tol) return "improved";
+    return "ok";
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    bool update = false;
+    std::string dir = "obj/regress";
+    std::string prog = "./EvoProg.exe";
+    std::string seed = RegressSeed;
+    int reps = RegressReps;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--update") {
+            update = true;
+        } else if (arg == "--dir" && i + 1 < argc) {
+            dir = argv[++i];
+        } else if (arg == "--prog" && i + 1 < argc) {
+            prog = argv[++i];
+        } else if (arg == "--seed" && i + 1 < argc) {
+            seed = argv[++i];
+        } else if (arg == "--reps" && i + 1 < argc) {
+            reps = std::max(1, std::atoi(argv[++i]));
+        } else {
+            std::cerr << "Usage: " << argv[0]
+                      << " [--update] [--dir D] [--prog P] [--seed S]"
+                      << " [--reps R]\n";
+            return 2;
+        }
+    }
+    mkdir(dir.c_str(), 0755);
+
+    baseline_map baseline = ReadBaseline(BaselineName);
+    range_map expected = ReadExpected(ExpectedName);
+    baseline_map new_baseline;
+    bool fail = false;
+
+    std::cout << "workload\tcheck\tvalue\tbaseline\tlimit\tstatus\n";
+    for (const Workload& wl : Workloads) {
+        std::string base = dir + "/" + wl.name;
+        std::string inpname = base + ".inp";
+        std::string statname = base + "_stats.txt";
+        override_type ovr = wl.overrides;
+        ovr.push_back({"max_num_thrds", "1"});
+        ovr.push_back({"Seed", seed});
+        ovr.push_back({"OutName", base + ".txt"});
+        ovr.push_back({"StatName", statname});
+        ovr.push_back({"StatSubPops", "0"});
+        if (!WriteInp(wl.inp, inpname, ovr)) {
+            fail = true;
+            continue;
+        }
+        InpFile inp(inpname, false);
+        std::size_t nsp = 0;
+        std::size_t ngsp = 0;
+        std::size_t g = 0;
+        std::size_t T = 0;
+        std::size_t numgen = 0;
+        Read(inp, nsp, "nsp");
+        Read(inp, ngsp, "ngsp");
+        Read(inp, g, "g");
+        Read(inp, T, "T");
+        Read(inp, numgen, "numgen");
+
+        RunResult res;
+        for (int r = 0; r < reps; ++r) {
+            // the statistics file is appended to, so start from an empty one
+            std::remove(statname.c_str());
+            RunResult rr = RunProg(prog, inpname, base + ".log");
+            if (!rr.ok) {
+                res.ok = false;
+                break;
+            }
+            if (r == 0 || rr.wall_seconds < res.wall_seconds) {
+                res.wall_seconds = rr.wall_seconds;
+            }
+            if (r == 0 || rr.cpu_seconds < res.cpu_seconds) {
+                res.cpu_seconds = rr.cpu_seconds;
+            }
+            res.peak_rss_mb = std::max(res.peak_rss_mb, rr.peak_rss_mb);
+            res.ok = true;
+        }
+        if (!res.ok) {
+            std::cout << wl.name << "\trun\t\t\t\tFAILED (see " << base
+                      << ".log)\n";
+            fail = true;
+            continue;
+        }
+        double learn_steps = static_cast<double>(nsp)*ngsp*g*T*numgen;
+        std::vector<std::pair<std::string, double>> metrics = {
+            {"wall_seconds", res.wall_seconds},
+            {"cpu_seconds", res.cpu_seconds},
+            {"learn_steps_per_s",
+             res.wall_seconds > 0.0 ? learn_steps/res.wall_seconds : 0.0},
+            {"peak_rss_mb", res.peak_rss_mb}
+        };
+        for (const auto& m : metrics) {
+            auto it = baseline.find({wl.name, m.first});
+            double tol = (m.first == "peak_rss_mb") ? MemTol : TimeTol;
+            std::cout << wl.name << '\t' << m.first << '\t' << m.second;
+            if (it != baseline.end()) {
+                tol = it->second.tol;
+                std::string st = CompareStatus(m.first, m.second, it->second);
+                std::cout << '\t' << it->second.value << '\t' << tol << '\t'
+                          << st << '\n';
+                if (st == "REGRESSION" && !update) fail = true;
+            } else {
+                std::cout << "\t\t\tno baseline\n";
+            }
+            new_baseline[{wl.name, m.first}] = Baseline{m.second, tol};
+        }
+
+        // summary statistics of the output, compared with expected ranges
+        std::map<std::string, double> means = LastMeans(statname);
+        for (const auto& e : expected) {
+            if (e.first.first != wl.name) continue;
+            const std::string& trait = e.first.second;
+            const Range& r = e.second;
+            auto it = means.find(trait);
+            std::cout << wl.name << "\tmean_" << trait << '\t';
+            if (it == means.end()) {
+                std::cout << "\t\t\tMISSING\n";
+                fail = true;
+                continue;
+            }
+            bool in_range = it->second >= r.lo && it->second <= r.hi;
+            std::cout << it->second << "\t\t[" << r.lo << ", " << r.hi
+                      << "]\t" << (in_range ? "ok" : "OUT_OF_RANGE") << '\n';
+            if (!in_range) fail = true;
+        }
+    }
+
+    if (update) {
+        std::ofstream os(BaselineName);
+        os << "# Baseline for Regress.exe: workload, metric, value and "
+           << "relative tolerance\n";
+        for (const auto& b : new_baseline) {
+            os << b.first.first << '\t' << b.first.second << '\t'
+               << b.second.value << '\t' << b.second.tol << '\n';
+        }
+        if (!os) {
+            std::cerr << "Failed to write " << BaselineName << '\n';
+            return 1;
+        }
+        std::cout << "Baseline written to " << BaselineName << '\n';
+    }
+    return fail ? 1 : 0;
+}
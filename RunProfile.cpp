@@ -0,0 +1,233 @@
+#include "RunProfile.hpp"
+#include <fstream>
+
+// The EvoProg program runs actor-critic learning simulations
+// Copyright (C) 2019  Olof Leimar
+// See Readme.md for copyright notice
+
+namespace {
+
+// quantiles over generations in the report
+const std::array<double, 3> ProfQuantiles = {{0.5, 0.9, 0.99}};
+const std::array<const char*, 3> ProfQuantNames = {{"p50", "p90", "p99"}};
+
+std::string JsonString(const std::string& s)
+{
+    std::string js = "\"";
+    for (char c : s) {
+        if (c == '"' || c == '\\') {
+            js += '\\';
+            js += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            js += ' ';
+        } else {
+            js += c;
+        }
+    }
+    return js + "\"";
+}
+
+void WriteGenStats(std::ostream& os, const RunStat& rs, const QuantSketch& qs)
+{
+    os << "{\"mean\": " << rs.mean << ", \"sd\": " << rs.SD();
+    for (std::size_t i = 0; i < ProfQuantiles.size(); ++i) {
+        os << ", \"" << ProfQuantNames[i] << "\": "
+           << qs.Quantile(ProfQuantiles[i]);
+    }
+    os << "}";
+}
+
+double PerSecond(double count, double secs)
+{
+    return secs > 0.0 ? count/secs : 0.0;
+}
+
+} // namespace
+
+
+//************************** Class PhaseClock ****************************
+
+void PhaseClock::EndGen()
+{
+    double gen_total = 0.0;
+    for (std::size_t ph = 0; ph < num_run_phases; ++ph) {
+        total[ph] += gen_t[ph];
+        rs[ph].Add(gen_t[ph]);
+        qs[ph].Add(gen_t[ph]);
+        gen_total += gen_t[ph];
+        gen_t[ph] = 0.0;
+    }
+    gen_rs.Add(gen_total);
+    gen_qs.Add(gen_total);
+}
+
+double PhaseClock::GenElapsed() const
+{
+    double tot = 0.0;
+    for (double t : gen_t) tot += t;
+    return tot;
+}
+
+double PhaseClock::Total() const
+{
+    double tot = 0.0;
+    for (double t : total) tot += t;
+    return tot;
+}
+
+
+//************************** Class LoadBalance ***************************
+
+void LoadBalance::AddGen(double serial)
+{
+    if (work.empty()) return;
+    double max_t = 0.0;
+    double sum_t = 0.0;
+    std::size_t max_thr = 0;
+    for (std::size_t thr = 0; thr < work.size(); ++thr) {
+        sum_t += work[thr].t;
+        if (work[thr].t > max_t) {
+            max_t = work[thr].t;
+            max_thr = thr;
+        }
+    }
+    double mean_t = sum_t/work.size();
+    double ratio = (mean_t > 0.0) ? max_t/mean_t : 1.0;
+    ratio_rs.Add(ratio);
+    ratio_qs.Add(ratio);
+    ++slowest[max_thr];
+    sum_max += max_t;
+    sum_mean += mean_t;
+    sum_serial += serial;
+}
+
+
+//**************************** Report ************************************
+
+bool WriteProfReport(const std::string& filename,
+                     const ProfInfo& info,
+                     const std::vector<PhaseClock>& clocks,
+                     const LoadBalance& lb,
+                     const std::vector<PerfCounters>& perfs)
+{
+    std::ofstream os(filename.c_str());
+    if (!os) return false;
+    double learn_steps = static_cast<double>(info.N)*info.T*info.generations;
+    double thread_total = 0.0;
+    for (const PhaseClock& pc : clocks) thread_total += pc.Total();
+    os << "{\n";
+    os << "  \"inp_file\": " << JsonString(info.inp_name) << ",\n";
+    os << "  \"num_thrds\": " << info.num_thrds << ",\n";
+    os << "  \"nsp\": " << info.nsp << ",\n";
+    os << "  \"N\": " << info.N << ",\n";
+    os << "  \"T\": " << info.T << ",\n";
+    os << "  \"generations\": " << info.generations << ",\n";
+    os << "  \"wall_seconds\": " << info.wall_seconds << ",\n";
+    os << "  \"throughput\": {\"learn_steps\": " << learn_steps
+       << ", \"learn_steps_per_second\": "
+       << PerSecond(learn_steps, info.wall_seconds)
+       << ", \"offspring\": " << info.offspring
+       << ", \"offspring_per_second\": "
+       << PerSecond(info.offspring, info.wall_seconds) << "},\n";
+    // the duration of generations, as seen by thread 0
+    if (!clocks.empty()) {
+        os << "  \"generation_seconds\": ";
+        WriteGenStats(os, clocks[0].GenStat(), clocks[0].GenQuant());
+        os << ",\n";
+    }
+    // phases, summed over threads, with the distribution of the time of a
+    // thread in a generation
+    os << "  \"phases\": {\n";
+    for (std::size_t ph = 0; ph < num_run_phases; ++ph) {
+        RunPhase rph = static_cast<RunPhase>(ph);
+        double tot = 0.0;
+        double max_thr = 0.0;
+        RunStat rs;
+        QuantSketch qs;
+        for (const PhaseClock& pc : clocks) {
+            tot += pc.Total(rph);
+            if (pc.Total(rph) > max_thr) max_thr = pc.Total(rph);
+            rs.Merge(pc.GenStat(rph));
+            qs.Merge(pc.GenQuant(rph));
+        }
+        os << "    \"" << RunPhaseNames[ph] << "\": {\"total_seconds\": "
+           << tot << ", \"fraction\": "
+           << (thread_total > 0.0 ? tot/thread_total : 0.0)
+           << ", \"max_thread_seconds\": " << max_thr
+           << ", \"per_generation\": ";
+        WriteGenStats(os, rs, qs);
+        os << "}" << (ph + 1 < num_run_phases ? "," : "") << "\n";
+    }
+    os << "  },\n";
+    // load balance: the parallel efficiency of the work on subpopulations is
+    // the mean over threads divided by the maximum, summed over generations
+    os << "  \"load_balance\": {\"imbalance_ratio\": ";
+    WriteGenStats(os, lb.RatioStat(), lb.RatioQuant());
+    os << ", \"work_max_seconds\": " << lb.MaxWork()
+       << ", \"work_mean_seconds\": " << lb.MeanWork()
+       << ", \"parallel_efficiency\": "
+       << (lb.MaxWork() > 0.0 ? lb.MeanWork()/lb.MaxWork() : 1.0)
+       << ", \"serial_seconds\": " << lb.Serial()
+       << ", \"critical_path_seconds\": " << lb.CriticalPath()
+       << ", \"slowest_thread_generations\": [";
+    for (std::size_t t = 0; t < lb.NumThrds(); ++t) {
+        os << (t > 0 ? ", " : "") << lb.Slowest(t);
+    }
+    os << "]},\n";
+    // performance counters, summed over threads (null if not available)
+    bool any_perf = false;
+    for (const PerfCounters& pc : perfs) any_perf = any_perf || pc.Active();
+    if (any_perf) {
+        os << "  \"counters\": {\n";
+        for (std::size_t ph = 0; ph < num_run_phases; ++ph) {
+            PerfCounters::counts_type sum{};
+            std::array<bool, num_perf_events> avail{};
+            for (const PerfCounters& pc : perfs) {
+                if (!pc.Active()) continue;
+                for (std::size_t ev = 0; ev < num_perf_events; ++ev) {
+                    PerfEvent pev = static_cast<PerfEvent>(ev);
+                    if (pc.Available(pev)) {
+                        avail[ev] = true;
+                        sum[ev] += pc.Count(ph, pev);
+                    }
+                }
+            }
+            os << "    \"" << RunPhaseNames[ph] << "\": {";
+            for (std::size_t ev = 0; ev < num_perf_events; ++ev) {
+                os << (ev > 0 ? ", " : "") << "\"" << PerfEventNames[ev]
+                   << "\": ";
+                if (avail[ev]) {
+                    os << sum[ev];
+                } else {
+                    os << "null";
+                }
+            }
+            // instructions per cycle
+            os << ", \"ipc\": ";
+            if (avail[pe_cycles] && avail[pe_instructions] &&
+                sum[pe_cycles] > 0) {
+                double instr = sum[pe_instructions];
+                os << instr/sum[pe_cycles];
+            } else {
+                os << "null";
+            }
+            os << "}" << (ph + 1 < num_run_phases ? "," : "") << "\n";
+        }
+        os << "  },\n";
+    }
+    // totals per thread
+    os << "  \"threads\": [\n";
+    for (std::size_t t = 0; t < clocks.size(); ++t) {
+        const PhaseClock& pc = clocks[t];
+        os << "    {\"thread\": " << t << ", \"total_seconds\": "
+           << pc.Total();
+        for (std::size_t ph = 0; ph < num_run_phases; ++ph) {
+            os << ", \"" << RunPhaseNames[ph] << "\": "
+               << pc.Total(static_cast<RunPhase>(ph));
+        }
+        os << "}" << (t + 1 < clocks.size() ? "," : "") << "\n";
+    }
+    os << "  ]\n";
+    os << "}\n";
+    return static_cast<bool>(os);
+}
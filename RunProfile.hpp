@@ -0,0 +1,162 @@
+#ifndef RUNPROFILE_HPP
+#define RUNPROFILE_HPP
+
+#include "PopStats.hpp"
+#include "PerfCounters.hpp"
+#include "RunTrace.hpp"
+#include <array>
+#include <chrono>
+#include <string>
+#include <vector>
+
+// The EvoProg program runs actor-critic learning simulations
+// Copyright (C) 2019  Olof Leimar
+// See Readme.md for copyright notice
+
+// This unit measures how the time of a run is divided between the phases of
+// a generation, separately for each thread. Each thread has a PhaseClock,
+// which works like a stop watch with laps: at the end of each phase, Lap()
+// attributes the time since the previous lap to the phase. The cost is one
+// reading of a steady clock per lap, so the timing can be left on. At the end
+// of a run, a report in JSON format can be written, with total times, the
+// distribution over generations, and the throughput. Optionally, hardware
+// performance counters (see PerfCounters.hpp) are read at the same laps, and
+// the laps are recorded as events in a timeline (see RunTrace.hpp).
+
+// Phases of a generation; the waits are at the barrier after the work on the
+// subpopulations (wait_work) and at the barrier after the serial part done
+// by thread 0 (wait_serial)
+enum RunPhase { rp_setup, rp_learn, rp_stats, rp_repro, rp_wait_work, rp_io,
+                rp_migrate, rp_wait_serial, num_run_phases };
+
+// Names of phases, in the order of RunPhase
+const std::array<const char*, num_run_phases> RunPhaseNames =
+    {{"setup", "learn", "stats", "repro", "wait_work", "io", "migrate",
+      "wait_serial"}};
+
+
+//************************** Class PhaseClock ****************************
+
+// Per-thread phase times; the class is aligned to a cache line, so that the
+// clocks of different threads can be kept in a vector
+
+class alignas(64) PhaseClock {
+public:
+    using clock_type = std::chrono::steady_clock;
+    PhaseClock() : perf{nullptr}, trace{nullptr}, gen_t{}, total{} {}
+    // Also read the counters pc at each lap (which should be opened by the
+    // thread using this clock)
+    void Attach(PerfCounters* pc) { perf = pc; }
+    // Also record each lap in the timeline tb (of the thread using this
+    // clock)
+    void Attach(TraceBuffer* tb) { trace = tb; }
+    // Start timing (the first lap starts now)
+    void Start()
+    {
+        last = clock_type::now();
+        if (perf) perf->Start();
+    }
+    // Attribute the time since the previous lap to phase ph
+    void Lap(RunPhase ph)
+    {
+        clock_type::time_point now = clock_type::now();
+        gen_t[ph] += std::chrono::duration<double>(now - last).count();
+        if (trace) trace->Add(ph, last, now);
+        last = now;
+        if (perf) perf->Lap(ph);
+    }
+    // Time since the start of the current generation (up to the last lap)
+    double GenElapsed() const;
+    // Add the phase times of the current generation to the statistics
+    void EndGen();
+    // Time of phase ph in the current generation (up to the last lap)
+    double GenTime(RunPhase ph) const { return gen_t[ph]; }
+    double Total(RunPhase ph) const { return total[ph]; }
+    double Total() const;
+    // per-generation statistics, for phases and for the whole generation
+    const RunStat& GenStat(RunPhase ph) const { return rs[ph]; }
+    const QuantSketch& GenQuant(RunPhase ph) const { return qs[ph]; }
+    const RunStat& GenStat() const { return gen_rs; }
+    const QuantSketch& GenQuant() const { return gen_qs; }
+private:
+    PerfCounters* perf;
+    TraceBuffer* trace;
+    clock_type::time_point last;
+    std::array<double, num_run_phases> gen_t;
+    std::array<double, num_run_phases> total;
+    std::array<RunStat, num_run_phases> rs;
+    std::array<QuantSketch, num_run_phases> qs;
+    RunStat gen_rs;
+    QuantSketch gen_qs;
+};
+
+
+//************************** Class LoadBalance ***************************
+
+// Load balance between threads: each thread sets the time of its work in a
+// generation, up to the barrier where threads wait for each other, and after
+// the barrier one thread adds the generation, together with the time of the
+// serial part (done by one thread while the others wait). The imbalance ratio
+// of a generation is the maximal work time of a thread divided by the mean
+// over threads, and the critical path is the maximal work time plus the
+// serial time.
+
+class LoadBalance {
+public:
+    explicit LoadBalance(std::size_t num_thrds = 0) :
+        work(num_thrds), slowest(num_thrds, 0) {}
+    void SetWork(std::size_t thr, double t) { work[thr].t = t; }
+    void AddGen(double serial);
+    std::size_t NumThrds() const { return work.size(); }
+    // statistics of the imbalance ratio over generations
+    const RunStat& RatioStat() const { return ratio_rs; }
+    const QuantSketch& RatioQuant() const { return ratio_qs; }
+    // sums over generations
+    double MaxWork() const { return sum_max; }
+    double MeanWork() const { return sum_mean; }
+    double Serial() const { return sum_serial; }
+    double CriticalPath() const { return sum_max + sum_serial; }
+    // number of generations in which thread thr had the longest work time
+    std::size_t Slowest(std::size_t thr) const { return slowest[thr]; }
+private:
+    // one slot per cache line, since threads write their own slots
+    struct alignas(64) Slot {
+    // public:
+        double t = 0.0;
+    };
+    std::vector<Slot> work;
+    std::vector<std::size_t> slowest;
+    RunStat ratio_rs;
+    QuantSketch ratio_qs;
+    double sum_max = 0.0;
+    double sum_mean = 0.0;
+    double sum_serial = 0.0;
+};
+
+
+//************************** Struct ProfInfo *****************************
+
+// Information about a run, for the report
+
+struct ProfInfo {
+// public:
+    std::string inp_name;
+    std::size_t num_thrds = 0;
+    std::size_t nsp = 0;
+    std::size_t N = 0;              // number of individuals
+    std::size_t T = 0;              // number of rounds per generation
+    std::size_t generations = 0;    // generations simulated in this run
+    std::size_t offspring = 0;      // offspring produced in this run
+    double wall_seconds = 0.0;
+};
+
+// Write a report, in JSON format, of the phase times of the threads, the
+// load balance, and the counts of any active performance counters in perfs;
+// returns false if the file could not be written
+bool WriteProfReport(const std::string& filename,
+                     const ProfInfo& info,
+                     const std::vector<PhaseClock>& clocks,
+                     const LoadBalance& lb,
+                     const std::vector<PerfCounters>& perfs);
+
+#endif // RUNPROFILE_HPP
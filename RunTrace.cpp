@@ -0,0 +1,108 @@
+#include "RunTrace.hpp"
+#include <cstdio>
+#include <fstream>
+
+// The EvoProg program runs actor-critic learning simulations
+// Copyright (C) 2019  Olof Leimar
+// See Readme.md for copyright notice
+
+//************************** Class TraceBuffer ***************************
+
+void TraceBuffer::Open(std::size_t capacity, clock_type::time_point origin,
+                       std::uint32_t merge_mask, std::uint32_t merge_cd)
+{
+    buf.assign(capacity, TraceEvent());
+    orig = origin;
+    merge = merge_mask;
+    merge_code = merge_cd;
+    head = 0;
+    count = 0;
+    dropped = 0;
+    on = false;
+}
+
+void TraceBuffer::Record(std::uint32_t ph, clock_type::time_point t0,
+                         clock_type::time_point t1)
+{
+    std::int64_t b = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        t0 - orig).count();
+    std::int64_t e = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        t1 - orig).count();
+    if (ph < 32 && (merge & (std::uint32_t(1) << ph))) {
+        ph = merge_code;
+        // extend the previous event, if it is a merged event that ends here
+        if (count > 0) {
+            TraceEvent& prev = buf[(head + buf.size() - 1) % buf.size()];
+            if (prev.ph == merge_code && prev.gen == gen &&
+                prev.begin_ns + prev.dur_ns == b) {
+                prev.dur_ns = e - prev.begin_ns;
+                if (prev.sp != sp) prev.sp = -1;
+                return;
+            }
+        }
+    }
+    TraceEvent& ev = buf[head];
+    ev.begin_ns = b;
+    ev.dur_ns = e - b;
+    ev.gen = gen;
+    ev.sp = sp;
+    ev.ph = ph;
+    head = (head + 1) % buf.size();
+    if (count < buf.size()) {
+        ++count;
+    } else {
+        ++dropped;
+    }
+}
+
+std::vector<TraceEvent> TraceBuffer::Events() const
+{
+    std::vector<TraceEvent> evs;
+    evs.reserve(count);
+    std::size_t start = (head + buf.size() - count) % buf.size();
+    for (std::size_t i = 0; i < count; ++i) {
+        evs.push_back(buf[(start + i) % buf.size()]);
+    }
+    return evs;
+}
+
+
+//**************************** Output ************************************
+
+bool WriteTrace(const std::string& filename,
+                const std::vector<TraceBuffer>& traces,
+                const std::vector<std::string>& names)
+{
+    std::ofstream os(filename.c_str());
+    if (!os) return false;
+    os << "{\"displayTimeUnit\": \"ms\",\n\"traceEvents\": [\n";
+    bool first = true;
+    char line[256];
+    for (std::size_t t = 0; t < traces.size(); ++t) {
+        std::snprintf(line, sizeof(line),
+                      "%s{\"name\": \"thread_name\", \"ph\": \"M\", "
+                      "\"pid\": 1, \"tid\": %zu, "
+                      "\"args\": {\"name\": \"thread %zu\"}}",
+                      first ? "" : ",\n", t, t);
+        os << line;
+        first = false;
+        for (const TraceEvent& ev : traces[t].Events()) {
+            const char* name =
+                ev.ph < names.size() ? names[ev.ph].c_str() : "?";
+            // times in microseconds
+            std::snprintf(line, sizeof(line),
+                          ",\n{\"name\": \"%s\", \"cat\": \"pggsim\", "
+                          "\"ph\": \"X\", \"ts\": %.3f, \"dur\": %.3f, "
+                          "\"pid\": 1, \"tid\": %zu, "
+                          "\"args\": {\"gen\": %d, \"sp\": %d}}",
+                          name, ev.begin_ns*1e-3, ev.dur_ns*1e-3, t,
+                          static_cast<int>(ev.gen), static_cast<int>(ev.sp));
+            os << line;
+        }
+    }
+    std::size_t dropped = 0;
+    for (const TraceBuffer& tb : traces) dropped += tb.Dropped();
+    os << "\n],\n\"otherData\": {\"dropped_events\": " << dropped
+       << "}}\n";
+    return static_cast<bool>(os);
+}
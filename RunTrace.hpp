@@ -0,0 +1,85 @@
+#ifndef RUNTRACE_HPP
+#define RUNTRACE_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// The EvoProg program runs actor-critic learning simulations
+// Copyright (C) 2019  Olof Leimar
+// See Readme.md for copyright notice
+
+// This unit records a timeline of a run, for viewing in a trace viewer
+// (chrome://tracing or https://ui.perfetto.dev). Each thread has a
+// TraceBuffer, which is a ring buffer of events with a begin time and a
+// duration; it is written only by its own thread, so no locks are needed,
+// and when it is full the oldest events are overwritten. The events are the
+// laps of a PhaseClock (see RunProfile.hpp), tagged with the generation and
+// subpopulation. To limit the size, only some generations are recorded, and
+// a set of phases can be merged into one event per generation. At the end of
+// a run, the buffers are written in the Chrome trace event format (JSON).
+
+struct TraceEvent {
+// public:
+    std::int64_t begin_ns;      // time since the origin
+    std::int64_t dur_ns;
+    std::int32_t gen;
+    std::int32_t sp;            // subpopulation (-1: none)
+    std::uint32_t ph;           // phase (or merge code)
+    std::uint32_t pad;
+};
+
+
+//************************** Class TraceBuffer ***************************
+
+// Ring buffer of events of one thread; the class is aligned to a cache line,
+// so that the buffers of different threads can be kept in a vector
+
+class alignas(64) TraceBuffer {
+public:
+    using clock_type = std::chrono::steady_clock;
+    TraceBuffer() : on{false}, merge{0}, merge_code{0}, gen{0}, sp{-1},
+        head{0}, count{0}, dropped{0} {}
+    // Allocate room for capacity events, with times relative to origin;
+    // phases ph with bit ph set in merge_mask are recorded as one event with
+    // phase code merge_cd, as long as they follow each other
+    void Open(std::size_t capacity, clock_type::time_point origin,
+              std::uint32_t merge_mask, std::uint32_t merge_cd);
+    bool Active() const { return !buf.empty(); }
+    // Start generation g, which is recorded if rec is true
+    void SetGen(int g, bool rec) { gen = g; on = rec && Active(); }
+    void SetSubPop(int n) { sp = n; }
+    // Record phase ph from t0 to t1
+    void Add(std::size_t ph, clock_type::time_point t0,
+             clock_type::time_point t1)
+    {
+        if (on) Record(static_cast<std::uint32_t>(ph), t0, t1);
+    }
+    // Events in the order they were recorded
+    std::vector<TraceEvent> Events() const;
+    // Number of events overwritten because the buffer was full
+    std::size_t Dropped() const { return dropped; }
+private:
+    void Record(std::uint32_t ph, clock_type::time_point t0,
+                clock_type::time_point t1);
+    bool on;
+    std::uint32_t merge;
+    std::uint32_t merge_code;
+    int gen;
+    int sp;
+    clock_type::time_point orig;
+    std::vector<TraceEvent> buf;
+    std::size_t head;           // position of the next event
+    std::size_t count;          // number of events in the buffer
+    std::size_t dropped;
+};
+
+// Write the events of the buffers (one per thread) in the Chrome trace event
+// format, with names of phases (and merge codes) in names; returns false if
+// the file could not be written
+bool WriteTrace(const std::string& filename,
+                const std::vector<TraceBuffer>& traces,
+                const std::vector<std::string>& names);
+
+#endif // RUNTRACE_HPP
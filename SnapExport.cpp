@@ -0,0 +1,134 @@
+#include "SnapStore.hpp"
+#include "TextWriter.hpp"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+
+// The EvoProg program runs actor-critic learning simulations
+// Copyright (C) 2019  Olof Leimar
+// See Readme.md for copyright notice
+
+// Lists the contents of a snapshot store, or exports data from it as
+// tab-separated text (compressed if the output file name ends in .gz), with
+// values written round-trip exact; for instance
+//     ./SnapExport.exe Data/Run12.pgs
+//     ./SnapExport.exe Data/Run12.pgs gen 1000 Data/Run12_g1000.txt
+//     ./SnapExport.exe Data/Run12.pgs col d Data/Run12_d.txt
+// The first lists the generations and columns, the second exports the
+// snapshot of generation 1000 (in the same format as a population file), and
+// the third exports column d for all generations, with the generation in the
+// first column.
+
+namespace {
+
+void List(const SnapReader& sr)
+{
+    std::cout << "Columns:";
+    for (std::size_t c = 0; c < sr.NumCols(); ++c) {
+        std::cout << ' ' << sr.ColName(c);
+    }
+    std::cout << "\ngen\tnrows\n";
+    for (int gen : sr.Gens()) {
+        std::cout << gen << '\t' << sr.NumRows(gen) << '\n';
+    }
+}
+
+bool ExportGen(const SnapReader& sr, int gen, const std::string& outname)
+{
+    if (!sr.HasGen(gen)) {
+        std::cout << "No snapshot for generation " << gen << '\n';
+        return false;
+    }
+    std::vector<std::vector<double>> data;
+    if (!sr.Snapshot(gen, data)) {
+        std::cout << sr.Error() << '\n';
+        return false;
+    }
+    TextWriter tw(outname, 0);
+    if (!tw) {
+        std::cout << "Cannot open " << outname << '\n';
+        return false;
+    }
+    for (std::size_t c = 0; c < sr.NumCols(); ++c) {
+        if (c > 0) tw.Put('\t');
+        tw.Put(sr.ColName(c));
+    }
+    tw.Put('\n');
+    std::size_t nrows = sr.NumRows(gen);
+    for (std::size_t i = 0; i < nrows; ++i) {
+        for (std::size_t c = 0; c < data.size(); ++c) {
+            if (c > 0) tw.Put('\t');
+            tw.Put(data[c][i]);
+        }
+        tw.Put('\n');
+    }
+    return tw.Close();
+}
+
+bool ExportCol(const SnapReader& sr,
+               const std::string& name,
+               const std::string& outname)
+{
+    std::size_t col = sr.ColIndex(name);
+    if (col == sr.NumCols()) {
+        std::cout << "Unknown column " << name << '\n';
+        return false;
+    }
+    TextWriter tw(outname, 0);
+    if (!tw) {
+        std::cout << "Cannot open " << outname << '\n';
+        return false;
+    }
+    tw.Put("gen\t");
+    tw.Put(name);
+    tw.Put('\n');
+    std::vector<double> v;
+    for (int gen : sr.Gens()) {
+        if (!sr.Column(gen, col, v)) {
+            std::cout << sr.Error() << '\n';
+            return false;
+        }
+        for (double x : v) {
+            tw.Put(static_cast<double>(gen));
+            tw.Put('\t');
+            tw.Put(x);
+            tw.Put('\n');
+        }
+    }
+    return tw.Close();
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    if (argc != 2 && argc != 5) {
+        std::cout << "Usage: " << argv[0] << " store [gen G | col NAME]"
+                  << " outfile\n";
+        return -1;
+    }
+    SnapReader sr(argv[1]);
+    if (!sr.OK()) {
+        std::cout << sr.Error() << '\n';
+        return -1;
+    }
+    if (argc == 2) {
+        List(sr);
+        return 0;
+    }
+    std::string what(argv[2]);
+    bool OK = false;
+    if (what == "gen") {
+        OK = ExportGen(sr, std::atoi(argv[3]), argv[4]);
+    } else if (what == "col") {
+        OK = ExportCol(sr, argv[3], argv[4]);
+    } else {
+        std::cout << "Unknown export " << what << '\n';
+    }
+    if (!OK) {
+        std::cout << "Export failed!\n";
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,366 @@
+#include "SnapStore.hpp"
+#include <algorithm>
+#include <cstring>
+#include <sys/types.h>
+
+#ifdef PGG_ZLIB
+#include <zlib.h>
+#endif
+
+// The EvoProg program runs actor-critic learning simulations
+// Copyright (C) 2019  Olof Leimar
+// See Readme.md for copyright notice
+
+namespace {
+
+const char Magic[8] = {'P', 'G', 'G', 'S', 'N', 'A', 'P', '\0'};
+const std::size_t HeaderSize = 40;
+const std::size_t EntrySize = sizeof(SnapEntry);
+const std::uint32_t CodecRaw = 0;
+const std::uint32_t CodecShuffleZlib = 1;
+
+// whether the number of values of a chunk fits its size: raw chunks hold
+// exactly nvals doubles, and deflate compresses at most 1032 to 1, so a
+// compressed chunk of size bytes holds at most 129*size doubles
+bool PlausibleNumVals(const SnapEntry& e)
+{
+    if (e.codec == CodecRaw) {
+        return e.size % sizeof(double) == 0 && e.nvals == e.size/sizeof(double);
+    }
+    return e.nvals/129 <= e.size;
+}
+
+static_assert(sizeof(SnapEntry) == 40, "unexpected size of SnapEntry");
+
+#ifdef PGG_ZLIB
+// Transpose the bytes of n doubles, so that the first bytes of all values
+// come first, then the second bytes, and so on; the high-order bytes of
+// similar values are then often equal, which makes the data compress much
+// better
+void ShuffleBytes(const double* v, std::size_t n, unsigned char* out)
+{
+    const unsigned char* in = reinterpret_cast<const unsigned char*>(v);
+    for (std::size_t i = 0; i < n; ++i) {
+        for (std::size_t b = 0; b < sizeof(double); ++b) {
+            out[b*n + i] = in[i*sizeof(double) + b];
+        }
+    }
+}
+
+void UnshuffleBytes(const unsigned char* in, std::size_t n, double* v)
+{
+    unsigned char* out = reinterpret_cast<unsigned char*>(v);
+    for (std::size_t i = 0; i < n; ++i) {
+        for (std::size_t b = 0; b < sizeof(double); ++b) {
+            out[i*sizeof(double) + b] = in[b*n + i];
+        }
+    }
+}
+#endif
+
+bool LessGenCol(const SnapEntry& a, const SnapEntry& b)
+{
+    return a.gen < b.gen || (a.gen == b.gen && a.col < b.col);
+}
+
+} // namespace
+
+
+//************************** Class SnapWriter ****************************
+
+SnapWriter::SnapWriter(const std::string& filename,
+                       const std::vector<std::string>& col_names,
+                       bool append) :
+    fp{nullptr},
+    ok{true},
+    ncols{col_names.size()},
+    end_off{0},
+    dirty{false}
+{
+    if (append) {
+        fp = std::fopen(filename.c_str(), "r+b");
+    }
+    if (fp) {
+        Open(filename, col_names);
+        return;
+    }
+    // create a new store, with an empty index
+    fp = std::fopen(filename.c_str(), "w+b");
+    if (!fp) {
+        Fail("cannot open " + filename);
+        return;
+    }
+    std::string nb;
+    for (std::size_t k = 0; k < col_names.size(); ++k) {
+        if (k > 0) nb += '\t';
+        nb += col_names[k];
+    }
+    std::uint32_t nc = ncols;
+    std::uint64_t hd[3] = {nb.size(), 0, 0};
+    std::vector<char> head(HeaderSize + nb.size(), '\0');
+    std::memcpy(&head[0], Magic, sizeof(Magic));
+    std::memcpy(&head[8], &SnapVersion, 4);
+    std::memcpy(&head[12], &nc, 4);
+    std::memcpy(&head[16], hd, sizeof(hd));
+    std::memcpy(&head[HeaderSize], nb.data(), nb.size());
+    if (std::fwrite(head.data(), 1, head.size(), fp) != head.size()) {
+        Fail("cannot write to " + filename);
+        return;
+    }
+    end_off = head.size();
+    dirty = true;
+}
+
+// read the header and index of an existing store
+bool SnapWriter::Open(const std::string& filename,
+                      const std::vector<std::string>& col_names)
+{
+    char head[HeaderSize];
+    std::uint32_t version = 0;
+    std::uint32_t nc = 0;
+    std::uint64_t hd[3] = {0, 0, 0};
+    if (std::fread(head, 1, HeaderSize, fp) != HeaderSize ||
+        std::memcmp(head, Magic, sizeof(Magic)) != 0) {
+        return Fail(filename + " is not a snapshot store");
+    }
+    std::memcpy(&version, head + 8, 4);
+    std::memcpy(&nc, head + 12, 4);
+    std::memcpy(hd, head + 16, sizeof(hd));
+    if (version != SnapVersion) {
+        return Fail("unsupported snapshot store version");
+    }
+    std::string nb(hd[0], '\0');
+    if (std::fread(&nb[0], 1, nb.size(), fp) != nb.size()) {
+        return Fail(filename + " is truncated");
+    }
+    std::vector<std::string> names = SplitColHeads(nb);
+    if (nc != ncols || names != col_names) {
+        return Fail("columns of " + filename + " do not match");
+    }
+    index.resize(hd[2]);
+    if (hd[2] > 0) {
+        if (fseeko(fp, hd[1], SEEK_SET) != 0 ||
+            std::fread(index.data(), EntrySize, index.size(), fp)
+            != index.size()) {
+            return Fail(filename + " has an invalid index");
+        }
+    }
+    if (fseeko(fp, 0, SEEK_END) != 0) {
+        return Fail("cannot seek in " + filename);
+    }
+    end_off = ftello(fp);
+    return ok;
+}
+
+bool SnapWriter::Add(int gen, const std::vector<std::vector<double>>& data)
+{
+    if (!ok) return ok;
+    if (data.size() != ncols) {
+        return Fail("wrong number of columns in snapshot");
+    }
+    if (fseeko(fp, end_off, SEEK_SET) != 0) {
+        return Fail("cannot seek in snapshot store");
+    }
+    for (std::size_t c = 0; c < ncols; ++c) {
+        const std::vector<double>& v = data[c];
+        SnapEntry e = {gen, static_cast<std::uint32_t>(c), end_off, 0,
+                       v.size(), CodecRaw, 0};
+        const void* out = v.data();
+        std::size_t out_size = v.size()*sizeof(double);
+#ifdef PGG_ZLIB
+        // compression level 1 is much faster than the default, and
+        // compresses shuffled doubles almost as well
+        std::vector<unsigned char> shuf(out_size);
+        ShuffleBytes(v.data(), v.size(), shuf.data());
+        uLongf zsize = compressBound(out_size);
+        zbuf.resize(zsize);
+        if (compress2(zbuf.data(), &zsize, shuf.data(), out_size, 1) == Z_OK
+            && zsize < out_size) {
+            e.codec = CodecShuffleZlib;
+            out = zbuf.data();
+            out_size = zsize;
+        }
+#endif
+        e.size = out_size;
+        if (out_size > 0 &&
+            std::fwrite(out, 1, out_size, fp) != out_size) {
+            return Fail("cannot write to snapshot store");
+        }
+        end_off += out_size;
+        index.push_back(e);
+    }
+    dirty = true;
+    return ok;
+}
+
+void SnapWriter::DropFrom(int gen)
+{
+    auto it = std::remove_if(index.begin(), index.end(),
+                             [gen](const SnapEntry& e)
+                             { return e.gen >= gen; });
+    if (it != index.end()) {
+        index.erase(it, index.end());
+        dirty = true;
+    }
+}
+
+bool SnapWriter::Commit()
+{
+    if (!ok || !dirty) return ok;
+    // write the index after the chunks, then let the header refer to it
+    std::uint64_t hd[2] = {end_off, index.size()};
+    if (fseeko(fp, end_off, SEEK_SET) != 0 ||
+        std::fwrite(index.data(), EntrySize, index.size(), fp)
+        != index.size() ||
+        std::fflush(fp) != 0 ||
+        fseeko(fp, 24, SEEK_SET) != 0 ||
+        std::fwrite(hd, sizeof(hd), 1, fp) != 1 ||
+        std::fflush(fp) != 0) {
+        return Fail("cannot write index of snapshot store");
+    }
+    // new chunks are written after the index
+    end_off += index.size()*EntrySize;
+    dirty = false;
+    return ok;
+}
+
+bool SnapWriter::Close()
+{
+    if (fp) {
+        Commit();
+        if (std::fclose(fp) != 0) ok = false;
+        fp = nullptr;
+    }
+    return ok;
+}
+
+
+//************************** Class SnapReader ****************************
+
+SnapReader::SnapReader(const std::string& filename) :
+    mf(filename),
+    ok{false}
+{
+    if (!mf) {
+        err = "cannot open " + filename;
+        return;
+    }
+    const char* data = mf.Data();
+    if (mf.Size() < HeaderSize ||
+        std::memcmp(data, Magic, sizeof(Magic)) != 0) {
+        err = filename + " is not a snapshot store";
+        return;
+    }
+    std::uint32_t version = 0;
+    std::uint32_t nc = 0;
+    std::uint64_t hd[3];
+    std::memcpy(&version, data + 8, 4);
+    std::memcpy(&nc, data + 12, 4);
+    std::memcpy(hd, data + 16, sizeof(hd));
+    if (version != SnapVersion) {
+        err = "unsupported snapshot store version";
+        return;
+    }
+    // the checks are divisions, which cannot overflow for a corrupt header
+    const std::uint64_t size = mf.Size();
+    if (hd[0] > size - HeaderSize || hd[1] > size ||
+        hd[2] > (size - hd[1])/EntrySize) {
+        err = filename + " is truncated or has an invalid header";
+        return;
+    }
+    names = SplitColHeads(std::string(data + HeaderSize, hd[0]));
+    if (names.size() != nc) {
+        err = "number of column names does not match number of columns";
+        return;
+    }
+    index.resize(hd[2]);
+    if (hd[2] > 0) {
+        std::memcpy(index.data(), data + hd[1], hd[2]*EntrySize);
+    }
+    for (const SnapEntry& e : index) {
+        if (e.col >= nc || e.off > size || e.size > size - e.off ||
+            !PlausibleNumVals(e)) {
+            err = filename + " has an invalid index";
+            return;
+        }
+    }
+    std::sort(index.begin(), index.end(), LessGenCol);
+    for (const SnapEntry& e : index) {
+        if (gens.empty() || gens.back() != e.gen) gens.push_back(e.gen);
+    }
+    ok = true;
+}
+
+std::size_t SnapReader::ColIndex(const std::string& name) const
+{
+    auto it = std::find(names.begin(), names.end(), name);
+    return it - names.begin();
+}
+
+bool SnapReader::HasGen(int gen) const
+{
+    return std::binary_search(gens.begin(), gens.end(), gen);
+}
+
+const SnapEntry* SnapReader::Find(int gen, std::size_t col) const
+{
+    SnapEntry key = {gen, static_cast<std::uint32_t>(col), 0, 0, 0, 0, 0};
+    auto it = std::lower_bound(index.begin(), index.end(), key, LessGenCol);
+    if (it == index.end() || it->gen != gen || it->col != col) {
+        return nullptr;
+    }
+    return &*it;
+}
+
+std::size_t SnapReader::NumRows(int gen) const
+{
+    const SnapEntry* e = Find(gen, 0);
+    return e ? e->nvals : 0;
+}
+
+bool SnapReader::Column(int gen, std::size_t col, std::vector<double>& v) const
+{
+    const SnapEntry* e = Find(gen, col);
+    if (!e) {
+        err = "no column " + std::to_string(col) + " for generation "
+            + std::to_string(gen);
+        return false;
+    }
+    const char* chunk = mf.Data() + e->off;
+    v.resize(e->nvals);
+    std::size_t nbytes = e->nvals*sizeof(double);
+    if (e->codec == CodecRaw) {
+        if (e->size != nbytes) {
+            err = "invalid chunk size";
+            return false;
+        }
+        if (nbytes > 0) std::memcpy(v.data(), chunk, nbytes);
+        return true;
+    }
+#ifdef PGG_ZLIB
+    if (e->codec == CodecShuffleZlib) {
+        std::vector<unsigned char> shuf(nbytes);
+        uLongf dsize = nbytes;
+        if (uncompress(shuf.data(), &dsize,
+                       reinterpret_cast<const Bytef*>(chunk), e->size)
+            != Z_OK || dsize != nbytes) {
+            err = "invalid compressed chunk";
+            return false;
+        }
+        UnshuffleBytes(shuf.data(), e->nvals, v.data());
+        return true;
+    }
+#endif
+    err = "unsupported chunk codec (compressed chunks require zlib)";
+    return false;
+}
+
+bool SnapReader::Snapshot(int gen, std::vector<std::vector<double>>& data)
+    const
+{
+    data.resize(names.size());
+    for (std::size_t c = 0; c < names.size(); ++c) {
+        if (!Column(gen, c, data[c])) return false;
+    }
+    return true;
+}
@@ -0,0 +1,135 @@
+#ifndef SNAPSTORE_HPP
+#define SNAPSTORE_HPP
+
+#include "PopBinFile.hpp"
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+
+// The EvoProg program runs actor-critic learning simulations
+// Copyright (C) 2019  Olof Leimar
+// See Readme.md for copyright notice
+
+// This unit implements a snapshot store: a single file holding population
+// snapshots from a number of generations. The data are stored column-wise,
+// in one chunk per generation and column, and each chunk is compressed
+// separately (if the program is built with zlib). An index gives the location
+// of each chunk, so that a reader can fetch a single generation, or a single
+// column across all generations, by decompressing only the chunks needed.
+//
+// Layout (all integers are in native byte order):
+//   char     magic[8]     "PGGSNAP" followed by '\0'
+//   uint32   version
+//   uint32   number of columns, ncols
+//   uint64   size in bytes of the column name block
+//   uint64   offset in bytes of the index (0 if there is no index)
+//   uint64   number of index entries
+//   char[]   column names, tab-separated
+//   chunks and indices
+//
+// Each index entry (40 bytes) contains
+//   int32    generation
+//   uint32   column
+//   uint64   offset in bytes of the chunk
+//   uint64   size in bytes of the stored chunk
+//   uint64   number of values in the chunk
+//   uint32   codec (0: raw doubles, 1: byte-shuffled and zlib-compressed)
+//   uint32   (unused)
+//
+// Snapshots are appended after the existing data, and the new index is
+// written after them; the header is updated last, so if the program is
+// interrupted the file still refers to the previous index. The space of
+// replaced indices is not reused.
+
+// Files with this extension are snapshot stores
+const char* const SnapExt = ".pgs";
+const std::uint32_t SnapVersion = 1;
+
+struct SnapEntry {
+// public:
+    std::int32_t gen;
+    std::uint32_t col;
+    std::uint64_t off;
+    std::uint64_t size;
+    std::uint64_t nvals;
+    std::uint32_t codec;
+    std::uint32_t unused;
+};
+
+
+//************************** Class SnapWriter ****************************
+
+// Writes snapshots to a store; with append set to true, an existing store
+// (which must have the same columns) is extended, otherwise a new store is
+// created. Snapshots are part of the store after a call to Commit() or
+// Close().
+
+class SnapWriter {
+public:
+    SnapWriter(const std::string& filename,
+               const std::vector<std::string>& col_names,
+               bool append = false);
+    ~SnapWriter() { Close(); }
+    SnapWriter(const SnapWriter&) = delete;
+    SnapWriter& operator=(const SnapWriter&) = delete;
+    bool OK() const { return ok; }
+    const std::string& Error() const { return err; }
+    // Add the snapshot of generation gen, with one vector of values for
+    // each column, in the order of the column names
+    bool Add(int gen, const std::vector<std::vector<double>>& data);
+    // Remove snapshots with generation gen or later from the index (for
+    // instance when a run continues from a checkpoint)
+    void DropFrom(int gen);
+    // Write the index and update the header
+    bool Commit();
+    bool Close();
+private:
+    bool Fail(const std::string& msg) { err = msg; ok = false; return ok; }
+    bool Open(const std::string& filename,
+              const std::vector<std::string>& col_names);
+    std::FILE* fp;
+    bool ok;
+    std::string err;
+    std::size_t ncols;
+    std::uint64_t end_off;  // where the next chunk is written
+    bool dirty;             // whether the index has changed
+    std::vector<SnapEntry> index;
+    std::vector<unsigned char> zbuf;
+};
+
+
+//************************** Class SnapReader ****************************
+
+// Reads a snapshot store (memory mapped); only the chunks asked for are
+// decompressed
+
+class SnapReader {
+public:
+    explicit SnapReader(const std::string& filename);
+    bool OK() const { return ok; }
+    const std::string& Error() const { return err; }
+    std::size_t NumCols() const { return names.size(); }
+    const std::string& ColName(std::size_t k) const { return names[k]; }
+    // Returns the index of the named column, or NumCols() if not present
+    std::size_t ColIndex(const std::string& name) const;
+    // The generations in the store, in increasing order
+    const std::vector<int>& Gens() const { return gens; }
+    bool HasGen(int gen) const;
+    // Number of individuals in the snapshot of generation gen
+    std::size_t NumRows(int gen) const;
+    // Get column col of the snapshot of generation gen
+    bool Column(int gen, std::size_t col, std::vector<double>& v) const;
+    // Get all columns of the snapshot of generation gen
+    bool Snapshot(int gen, std::vector<std::vector<double>>& data) const;
+private:
+    const SnapEntry* Find(int gen, std::size_t col) const;
+    MappedFile mf;
+    bool ok;
+    mutable std::string err;
+    std::vector<std::string> names;
+    std::vector<int> gens;
+    std::vector<SnapEntry> index;  // sorted by generation and column
+};
+
+#endif // SNAPSTORE_HPP
@@ -0,0 +1,88 @@
+#include "TextReader.hpp"
+#include <algorithm>
+#include <iostream>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#ifdef PGG_ZLIB
+#include <zlib.h>
+#endif
+
+// The EvoProg program runs actor-critic learning simulations
+// Copyright (C) 2019  Olof Leimar
+// See Readme.md for copyright notice
+
+//************************** Class TextBuffer ****************************
+
+TextBuffer::TextBuffer(const std::string& filename) :
+    data{nullptr},
+    size{0}
+{
+    bool gzname = filename.size() > 3 &&
+        filename.compare(filename.size() - 3, 3, ".gz") == 0;
+    if (gzname) {
+#ifdef PGG_ZLIB
+        gzFile gzf = gzopen(filename.c_str(), "rb");
+        if (!gzf) return;
+        gzbuffer(gzf, 1 << 18);
+        const std::size_t block = 1 << 22;
+        std::size_t n = 0;
+        int nread = 0;
+        do {
+            buf.resize(n + block);
+            nread = gzread(gzf, &buf[n], block);
+            if (nread > 0) n += nread;
+        } while (nread == static_cast<int>(block));
+        gzclose(gzf);
+        if (nread < 0) return;
+        buf.resize(n);
+        data = buf.data();
+        size = n;
+#else
+        std::cerr << "Compressed input from " << filename
+                  << " requires building with zlib\n";
+#endif
+    } else {
+        mf.reset(new MappedFile(filename));
+        if (!*mf) return;
+        data = mf->Data();
+        size = mf->Size();
+    }
+}
+
+
+//************************ Functions for parsing *************************
+
+std::size_t NumReadThreads()
+{
+#ifdef _OPENMP
+    return omp_get_max_threads();
+#else
+    return 1;
+#endif
+}
+
+std::vector<chunk_type> SplitLines(const char* text, std::size_t beg,
+                                   std::size_t end, std::size_t n)
+{
+    std::vector<chunk_type> chunks;
+    if (n == 0) n = 1;
+    // use several chunks per thread, for better load balance
+    std::size_t nch = (n > 1) ? 4*n : 1;
+    std::size_t len = (end - beg)/nch + 1;
+    std::size_t pos = beg;
+    while (pos < end) {
+        std::size_t stop = std::min(pos + len, end);
+        while (stop < end && text[stop - 1] != '\n') ++stop;
+        chunks.emplace_back(pos, stop);
+        pos = stop;
+    }
+    return chunks;
+}
+
+std::size_t LineNumber(const char* text, std::size_t pos)
+{
+    return std::count(text, text + pos, '\n') + 1;
+}
@@ -0,0 +1,135 @@
+#ifndef TEXTREADER_HPP
+#define TEXTREADER_HPP
+
+#include "PopBinFile.hpp"
+#include <charconv>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+// The EvoProg program runs actor-critic learning simulations
+// Copyright (C) 2019  Olof Leimar
+// See Readme.md for copyright notice
+
+// This unit implements parallel parsing of tab-separated population files.
+// The whole file is made available in memory (memory mapped, or decompressed
+// if the file name ends in .gz), split into line-aligned chunks, and the
+// chunks are parsed on all available threads using std::from_chars.
+
+//************************** Class TextBuffer ****************************
+
+class TextBuffer {
+public:
+    explicit TextBuffer(const std::string& filename);
+    bool operator!() const { return data == nullptr; }
+    const char* Data() const { return data; }
+    std::size_t Size() const { return size; }
+private:
+    std::unique_ptr<MappedFile> mf;
+    std::vector<char> buf;
+    const char* data;
+    std::size_t size;
+};
+
+
+//************************ Functions for parsing *************************
+
+using chunk_type = std::pair<std::size_t, std::size_t>;
+
+// Number of threads to use for parsing
+std::size_t NumReadThreads();
+
+// Split the range [beg, end) of the text into at most n chunks, where each
+// chunk starts at the beginning of a line and ends after a newline (or at
+// end)
+std::vector<chunk_type> SplitLines(const char* text, std::size_t beg,
+                                   std::size_t end, std::size_t n);
+
+// Return the line number (counting from 1) of position pos in the text
+std::size_t LineNumber(const char* text, std::size_t pos);
+
+// Parse up to ncols numbers, separated by tabs or blanks, from a line
+// starting at p, with end of text at end; returns the number of values read
+// and sets p to the start of the next line
+inline std::size_t ParseLine(const char*& p, const char* end,
+                             double* vals, std::size_t ncols)
+{
+    std::size_t k = 0;
+    while (p < end && *p != '\n') {
+        if (*p == '\t' || *p == ' ' || *p == '\r') {
+            ++p;
+            continue;
+        }
+        if (k == ncols) {
+            ++k; // too many values on line
+            while (p < end && *p != '\n') ++p;
+            break;
+        }
+        // from_chars does not accept a leading plus sign
+        if (*p == '+') ++p;
+        auto res = std::from_chars(p, end, vals[k]);
+        if (res.ec != std::errc()) {
+            while (p < end && *p != '\n') ++p;
+            break;
+        }
+        p = res.ptr;
+        ++k;
+    }
+    if (p < end) ++p; // skip newline
+    return k;
+}
+
+// Parse individuals of type Ind, which should have the static member
+// num_cols and the member function SetCol(std::size_t, double), from the
+// text following the first line (column heads); on return, inds contains one
+// vector of individuals per chunk, in the order of the text. If a line does
+// not contain exactly Ind::num_cols values, false is returned and err_line
+// is set to its line number.
+template<typename Ind>
+bool ParseIndividuals(const TextBuffer& tb,
+                      std::vector<std::vector<Ind>>& inds,
+                      std::size_t& err_line)
+{
+    const char* text = tb.Data();
+    std::size_t size = tb.Size();
+    std::size_t beg = 0;
+    while (beg < size && text[beg] != '\n') ++beg;
+    if (beg < size) ++beg;
+    std::vector<chunk_type> chunks =
+        SplitLines(text, beg, size, NumReadThreads());
+    std::size_t nch = chunks.size();
+    inds.assign(nch, std::vector<Ind>());
+    std::vector<std::size_t> err_pos(nch, size);
+#pragma omp parallel for schedule(dynamic, 1)
+    for (std::size_t c = 0; c < nch; ++c) {
+        const std::size_t ncols = Ind::num_cols;
+        double vals[ncols];
+        const char* p = text + chunks[c].first;
+        const char* end = text + chunks[c].second;
+        std::vector<Ind>& ci = inds[c];
+        // rough guess of the number of lines in the chunk
+        ci.reserve((end - p)/(8*ncols) + 1);
+        Ind indi;
+        while (p < end) {
+            const char* line = p;
+            std::size_t k = ParseLine(p, end, vals, ncols);
+            if (k == 0) continue; // empty line
+            if (k != ncols) {
+                err_pos[c] = line - text;
+                break;
+            }
+            for (std::size_t j = 0; j < ncols; ++j) indi.SetCol(j, vals[j]);
+            ci.push_back(indi);
+        }
+    }
+    for (std::size_t c = 0; c < nch; ++c) {
+        if (err_pos[c] < size) {
+            err_line = LineNumber(text, err_pos[c]);
+            return false;
+        }
+    }
+    return true;
+}
+
+#endif // TEXTREADER_HPP
@@ -0,0 +1,135 @@
+#include "TextWriter.hpp"
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+#ifdef PGG_ZLIB
+#include <zlib.h>
+#endif
+
+// The EvoProg program runs actor-critic learning simulations
+// Copyright (C) 2019  Olof Leimar
+// See Readme.md for copyright notice
+
+namespace {
+
+// room needed in the buffer for one formatted number
+const std::size_t MaxNumLen = 32;
+
+// 10^prec, for precisions up to 15, above which integer values are
+// written with an exponent in the general format
+const double IntLimit[16] = {1.0, 1.0e1, 1.0e2, 1.0e3, 1.0e4, 1.0e5, 1.0e6,
+    1.0e7, 1.0e8, 1.0e9, 1.0e10, 1.0e11, 1.0e12, 1.0e13, 1.0e14, 1.0e15};
+
+// zlib compression level: level 1 is several times faster than the default
+// level 6, and compresses population files almost as well (appending to a
+// gzip file adds a new gzip member, which is allowed by the format)
+const char* const GzMode = "wb1";
+const char* const GzAppendMode = "ab1";
+
+} // namespace
+
+//************************** Class TextWriter ****************************
+
+TextWriter::TextWriter(const std::string& filename,
+                       int a_prec,
+                       std::size_t block_size,
+                       bool append) :
+    fp{nullptr},
+    gz{nullptr},
+    buf(block_size < MaxNumLen ? MaxNumLen : block_size),
+    pos{0},
+    prec{a_prec},
+    open{false},
+    ok{true}
+{
+    if (IsCompressedName(filename)) {
+#ifdef PGG_ZLIB
+        gzFile gzf = gzopen(filename.c_str(), append ? GzAppendMode : GzMode);
+        if (gzf) {
+            gzbuffer(gzf, 1 << 18);
+            gz = gzf;
+            open = true;
+        }
+#else
+        std::cerr << "Compressed output to " << filename
+                  << " requires building with zlib\n";
+#endif
+    } else {
+        fp = std::fopen(filename.c_str(), append ? "ab" : "wb");
+        open = (fp != nullptr);
+    }
+    ok = open;
+}
+
+bool TextWriter::IsCompressedName(const std::string& filename)
+{
+    return filename.size() > 3 &&
+        filename.compare(filename.size() - 3, 3, ".gz") == 0;
+}
+
+void TextWriter::Put(double v)
+{
+    if (buf.size() - pos < MaxNumLen) Flush();
+    char* first = &buf[pos];
+    char* last = first + MaxNumLen;
+    std::to_chars_result res;
+    // integer values are written as integers when the general format would
+    // do the same (it uses an exponent from 10^prec, and keeps the sign of
+    // -0.0)
+    double int_lim = (prec > 0 && prec < 16) ? IntLimit[prec] : 9.0e15;
+    if (v == std::trunc(v) && std::fabs(v) < int_lim && !std::signbit(v)) {
+        res = std::to_chars(first, last, static_cast<long long>(v));
+    } else if (prec > 0) {
+        res = std::to_chars(first, last, v, std::chars_format::general, prec);
+    } else {
+        res = std::to_chars(first, last, v);
+    }
+    if (res.ec != std::errc()) {
+        // the number did not fit (a precision above 17 digits), so it is
+        // written round-trip exact, which always fits
+        res = std::to_chars(first, last, v);
+        if (res.ec != std::errc()) {
+            ok = false;
+            return;
+        }
+    }
+    pos += res.ptr - first;
+}
+
+void TextWriter::Put(const std::string& s)
+{
+    for (char c : s) Put(c);
+}
+
+void TextWriter::Flush()
+{
+    if (pos > 0 && open) {
+        if (fp) {
+            if (std::fwrite(buf.data(), 1, pos, fp) != pos) ok = false;
+        }
+#ifdef PGG_ZLIB
+        if (gz) {
+            int n = gzwrite(static_cast<gzFile>(gz), buf.data(), pos);
+            if (n != static_cast<int>(pos)) ok = false;
+        }
+#endif
+    }
+    pos = 0;
+}
+
+bool TextWriter::Close()
+{
+    if (open) {
+        Flush();
+        if (fp && std::fclose(fp) != 0) ok = false;
+#ifdef PGG_ZLIB
+        if (gz && gzclose(static_cast<gzFile>(gz)) != Z_OK) ok = false;
+#endif
+        fp = nullptr;
+        gz = nullptr;
+        open = false;
+    }
+    return ok;
+}
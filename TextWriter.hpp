@@ -0,0 +1,58 @@
+#ifndef TEXTWRITER_HPP
+#define TEXTWRITER_HPP
+
+#include <string>
+#include <vector>
+#include <cstdio>
+
+// The EvoProg program runs actor-critic learning simulations
+// Copyright (C) 2019  Olof Leimar
+// See Readme.md for copyright notice
+
+//************************** Class TextWriter ****************************
+
+// This class writes text output, such as tab-separated population files, with
+// numbers formatted by std::to_chars (independent of locale) into a large
+// buffer, which is written to file in blocks. If the file name ends in .gz
+// the output is gzip-compressed (this requires that the program is built with
+// zlib, which is the default in the Makefile). Compressed files can be read
+// directly by read.delim in R.
+
+// The precision is the number of significant digits for doubles (up to 17);
+// the value 6 gives the same output as the default for std::ostream, and the
+// value 0 gives the shortest representation that reads back as exactly the
+// same double (round-trip exact). With a precision, doubles with integer
+// values below 10^precision are written as integers, as by std::ostream.
+// With append set to true, output is added to the end of an existing file.
+
+class TextWriter {
+public:
+    static const std::size_t DefBlockSize = 1 << 20;
+    explicit TextWriter(const std::string& filename,
+                        int a_prec = 6,
+                        std::size_t block_size = DefBlockSize,
+                        bool append = false);
+    ~TextWriter() { Close(); }
+    TextWriter(const TextWriter&) = delete;
+    TextWriter& operator=(const TextWriter&) = delete;
+    // This operator can be used to check if the file was opened
+    bool operator!() const { return !open; }
+    static bool IsCompressedName(const std::string& filename);
+    void Put(double v);
+    void Put(char c) { if (pos == buf.size()) Flush(); buf[pos++] = c; }
+    void Put(const std::string& s);
+    void Put(const char* s) { while (*s) Put(*s++); }
+    // Flushes and closes the file; returns true if all output was written
+    bool Close();
+private:
+    void Flush();
+    std::FILE* fp;
+    void* gz;       // gzFile, when compressed
+    std::vector<char> buf;
+    std::size_t pos;
+    int prec;
+    bool open;
+    bool ok;
+};
+
+#endif // TEXTWRITER_HPP
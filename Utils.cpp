@@ -3,6 +3,9 @@
 #include <iostream>
 #include <ctime>
 #include <cstring>
+#include <cerrno>
+#include <sys/socket.h>
+#include <sys/types.h>
 
 // The EvoProg program runs actor-critic learning simulations
 // Copyright (C) 2019  Olof Leimar
@@ -119,3 +122,20 @@ int ProgressBar::Final() const
     Out << '\n';
     return Count;
 }
+
+bool SendAll(int fd, const std::string& s)
+{
+#ifdef MSG_NOSIGNAL
+    const int flags = MSG_NOSIGNAL;
+#else
+    const int flags = 0;
+#endif
+    std::size_t pos = 0;
+    while (pos < s.size()) {
+        ssize_t n = send(fd, s.data() + pos, s.size() - pos, flags);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        pos += n;
+    }
+    return true;
+}
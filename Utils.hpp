@@ -61,6 +61,11 @@ public:
 };
 
 
+// SendAll: Send all of s on the socket fd, retrying when interrupted by a
+// signal (and without SIGPIPE where MSG_NOSIGNAL exists); false on error
+bool SendAll(int fd, const std::string& s);
+
+
 // ProgressBar: Use this class for a progress bar that displays percentages
 // from 0 to 100 on a stream (usually std::cout)
 class ProgressBar {